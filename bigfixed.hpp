@@ -0,0 +1,233 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "floatexp.hpp"
+
+namespace mandelbrot {
+
+// Sign-magnitude fixed point number with a runtime number of 32 bit fraction
+// limbs. limbs are little endian: limbs[0] is the least significant fraction
+// limb and limbs.back() is the integer part. Only meant for values in the
+// neighbourhood of the mandelbrot set, so the integer part is a single limb.
+struct BigFixed {
+  std::vector<uint32_t> limbs = std::vector<uint32_t>(1, 0);
+  bool negative = false;
+
+  BigFixed() = default;
+  explicit BigFixed(double value, size_t fractionLimbs = 2) {
+    setFractionLimbs(fractionLimbs);
+    negative = value < 0.0;
+    value = std::abs(value);
+    for (size_t i = limbs.size(); i-- > 0;) {
+      const double digit = std::floor(value);
+      limbs[i] = uint32_t(digit);
+      value = (value - digit) * 4294967296.0;
+    }
+  }
+
+  static inline auto fromFloatExp(FloatExp value, size_t fractionLimbs)
+      -> BigFixed {
+    BigFixed result;
+    result.setFractionLimbs(fractionLimbs);
+    if (value.mantissa == 0.0) {
+      return result;
+    }
+    result.negative = value.mantissa < 0.0;
+    // a double has 53 significant bits, spread them over at most 3 limbs.
+    const uint64_t bits = uint64_t(std::ldexp(std::abs(value.mantissa), 53));
+    const int64_t lowBit = value.exponent - 53 + int64_t(fractionLimbs) * 32;
+    for (int b = 0; b < 53; b++) {
+      if (!(bits >> b & 1)) {
+        continue;
+      }
+      const int64_t position = lowBit + b;
+      if (position < 0 || position >= int64_t(result.limbs.size()) * 32) {
+        continue;
+      }
+      result.limbs[position / 32] |= 1u << (position % 32);
+    }
+    return result;
+  }
+
+  inline auto fractionLimbs() const -> size_t { return limbs.size() - 1; }
+
+  // changes precision, keeping the most significant limbs.
+  inline auto setFractionLimbs(size_t count) -> void {
+    const size_t current = fractionLimbs();
+    if (count > current) {
+      limbs.insert(limbs.begin(), count - current, 0);
+    } else if (count < current) {
+      limbs.erase(limbs.begin(), limbs.begin() + (current - count));
+    }
+  }
+
+  inline auto isZero() const -> bool {
+    return std::all_of(limbs.begin(), limbs.end(),
+                       [](uint32_t l) { return l == 0; });
+  }
+
+  inline auto toDouble() const -> double {
+    double value = 0.0;
+    double scale = 1.0;
+    for (size_t i = limbs.size(); i-- > 0 && scale > 1e-300;) {
+      value += limbs[i] * scale;
+      scale *= 1.0 / 4294967296.0;
+    }
+    return negative ? -value : value;
+  }
+
+  // what toDouble leaves out, the two together are a double-double.
+  inline auto lowDouble() const -> double {
+    return (*this - BigFixed(toDouble(), fractionLimbs())).toDouble();
+  }
+
+  // the limbs in two's complement instead, with fractionLimbs of them below
+  // the integer one. what shader.comp's fixed point tier takes.
+  inline auto twosComplement(size_t fractionLimbs) const
+      -> std::vector<uint32_t> {
+    BigFixed value = *this;
+    value.setFractionLimbs(fractionLimbs);
+    if (value.negative) {
+      uint64_t carry = 1;
+      for (uint32_t &limb : value.limbs) {
+        const uint64_t sum = uint64_t(~limb) + carry;
+        limb = uint32_t(sum);
+        carry = sum >> 32;
+      }
+    }
+    return value.limbs;
+  }
+
+  // extended range version of toDouble, for differences between nearby
+  // points that a double would flush to 0.
+  inline auto toFloatExp() const -> FloatExp {
+    for (size_t i = limbs.size(); i-- > 0;) {
+      if (limbs[i] == 0) {
+        continue;
+      }
+      // the top three limbs from here hold more than a double's mantissa.
+      const size_t low = i - std::min<size_t>(i, 2);
+      double value = 0.0;
+      for (size_t j = i + 1; j-- > low;) {
+        value = value * 4294967296.0 + limbs[j];
+      }
+      return FloatExp(negative ? -value : value)
+          .ldexp((int64_t(low) - int64_t(fractionLimbs())) * 32);
+    }
+    return FloatExp(0.0);
+  }
+
+  friend inline auto operator-(BigFixed a) -> BigFixed {
+    a.negative = !a.negative && !a.isZero();
+    return a;
+  }
+
+  friend inline auto operator+(const BigFixed &a, const BigFixed &b)
+      -> BigFixed {
+    BigFixed x = a, y = b;
+    matchPrecision(x, y);
+    if (x.negative == y.negative) {
+      addMagnitude(x.limbs, y.limbs);
+      return x;
+    }
+    if (compareMagnitude(x.limbs, y.limbs) < 0) {
+      std::swap(x, y);
+    }
+    subMagnitude(x.limbs, y.limbs);
+    x.negative = x.negative && !x.isZero();
+    return x;
+  }
+  friend inline auto operator-(const BigFixed &a, const BigFixed &b)
+      -> BigFixed {
+    return a + -b;
+  }
+
+  // truncating multiply at the larger precision of the two operands.
+  friend inline auto operator*(const BigFixed &a, const BigFixed &b)
+      -> BigFixed {
+    BigFixed x = a, y = b;
+    matchPrecision(x, y);
+    const size_t n = x.limbs.size();
+    const size_t fraction = n - 1;
+    std::vector<uint64_t> product(2 * n + 1, 0);
+    // the lowest fraction-1 columns only feed carries into the result, skip
+    // all but the top of them like a truncated multiply would.
+    const size_t firstColumn = fraction > 2 ? fraction - 2 : 0;
+    for (size_t i = 0; i < n; i++) {
+      uint64_t carry = 0;
+      const size_t jStart = firstColumn > i ? firstColumn - i : 0;
+      for (size_t j = jStart; j < n; j++) {
+        const uint64_t t =
+            uint64_t(x.limbs[i]) * y.limbs[j] + product[i + j] + carry;
+        product[i + j] = t & 0xffffffffu;
+        carry = t >> 32;
+      }
+      for (size_t k = i + n; carry; k++) {
+        const uint64_t t = product[k] + carry;
+        product[k] = t & 0xffffffffu;
+        carry = t >> 32;
+      }
+    }
+    BigFixed result;
+    result.limbs.assign(n, 0);
+    for (size_t i = 0; i < n; i++) {
+      result.limbs[i] = uint32_t(product[i + fraction]);
+    }
+    result.negative = (x.negative != y.negative) && !result.isZero();
+    return result;
+  }
+
+  inline auto operator+=(const BigFixed &o) -> BigFixed & {
+    return *this = *this + o;
+  }
+  inline auto operator-=(const BigFixed &o) -> BigFixed & {
+    return *this = *this - o;
+  }
+
+  friend inline auto operator==(const BigFixed &a, const BigFixed &b) -> bool {
+    return a.negative == b.negative && a.limbs == b.limbs;
+  }
+
+private:
+  static inline auto matchPrecision(BigFixed &a, BigFixed &b) -> void {
+    const size_t count = std::max(a.fractionLimbs(), b.fractionLimbs());
+    a.setFractionLimbs(count);
+    b.setFractionLimbs(count);
+  }
+
+  static inline auto compareMagnitude(const std::vector<uint32_t> &a,
+                                      const std::vector<uint32_t> &b) -> int {
+    for (size_t i = a.size(); i-- > 0;) {
+      if (a[i] != b[i]) {
+        return a[i] < b[i] ? -1 : 1;
+      }
+    }
+    return 0;
+  }
+
+  static inline auto addMagnitude(std::vector<uint32_t> &a,
+                                  const std::vector<uint32_t> &b) -> void {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+      const uint64_t t = uint64_t(a[i]) + b[i] + carry;
+      a[i] = uint32_t(t);
+      carry = t >> 32;
+    }
+  }
+
+  // requires |a| >= |b|.
+  static inline auto subMagnitude(std::vector<uint32_t> &a,
+                                  const std::vector<uint32_t> &b) -> void {
+    int64_t borrow = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+      int64_t t = int64_t(a[i]) - b[i] - borrow;
+      borrow = t < 0;
+      a[i] = uint32_t(t + (borrow << 32));
+    }
+  }
+};
+
+} // namespace mandelbrot
@@ -0,0 +1,621 @@
+#include "cpu_renderer.hpp"
+#include "simd_kernel.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace mandelbrot {
+
+namespace {
+
+using Complex = std::complex<double>;
+
+// std::complex multiplication drags in the inf/nan recovery path, the
+// shader doesn't have one either.
+inline auto cmul(Complex a, Complex b) -> Complex {
+  return {a.real() * b.real() - a.imag() * b.imag(),
+          a.real() * b.imag() + a.imag() * b.real()};
+}
+
+inline auto norm(Complex z) -> double {
+  return z.real() * z.real() + z.imag() * z.imag();
+}
+
+// same as inside_main_bulbs in shader.comp, margin included.
+inline auto insideMainBulbs(double cx, double cy, double margin) -> int {
+  const double x = cx - 0.25;
+  const double q = x * x + cy * cy;
+  if (q * (q + x) <= 0.25 * cy * cy - margin) {
+    return 1;
+  }
+  return (cx + 1.0) * (cx + 1.0) + cy * cy <= 0.0625 - margin ? 2 : 0;
+}
+
+// doubleBulbMargin in shader.comp
+constexpr double doubleBulbMargin = 1e-14;
+
+// same as iterate_perturbed in shader.comp, distance is only estimated when
+// it isn't null.
+auto iteratePerturbed(const Frame &frame, Complex dc, double *distance,
+                      double &smooth) -> int {
+  const auto &orbit = frame.orbit->points;
+  const auto &series = *frame.series;
+  const auto &steps = frame.bla->steps;
+  const auto &levelOffsets = frame.bla->levelOffsets;
+  const int levels = int(levelOffsets.size());
+  const int orbitLength = int(orbit.size());
+
+  const Complex u = dc / series.radius;
+  Complex dz = cmul(cmul(cmul(series.c, u) + series.b, u) + series.a, u);
+  Complex derivative;
+  if (distance) {
+    *distance = std::numeric_limits<double>::infinity();
+    derivative =
+        (cmul(3.0 * cmul(series.c, u) + 2.0 * series.b, u) + series.a) /
+        series.radius;
+  }
+  smooth = frame.maxIterations;
+  int m = series.skipIterations;
+  int iterations = series.skipIterations;
+
+  while (iterations < frame.maxIterations) {
+    bool stepped = false;
+    if (m > 0) {
+      const int top =
+          m == 1 ? levels - 1
+                 : std::min(levels - 1, std::countr_zero(unsigned(m - 1)));
+      const double dzLength = std::abs(dz);
+      for (int level = top; level >= 0; level--) {
+        const int index = levelOffsets[level] + ((m - 1) >> level);
+        const int end =
+            level + 1 < levels ? levelOffsets[level + 1] : int(steps.size());
+        if (index >= end) {
+          continue;
+        }
+        const BlaTable::Step &linear = steps[index];
+        if (dzLength < linear.radius &&
+            iterations + linear.iterations <= frame.maxIterations) {
+          dz = cmul(linear.a, dz) + cmul(linear.b, dc);
+          if (distance) {
+            derivative = cmul(linear.a, derivative) + linear.b;
+          }
+          m += linear.iterations;
+          iterations += linear.iterations;
+          stepped = true;
+          break;
+        }
+      }
+    }
+    if (!stepped) {
+      if (distance) {
+        derivative = 2.0 * cmul(orbit[m] + dz, derivative) + 1.0;
+      }
+      dz = cmul(2.0 * orbit[m] + dz, dz) + dc;
+      m++;
+      iterations++;
+    }
+
+    const Complex z = orbit[m] + dz;
+    const double r = norm(z);
+    if (r >= 4.0) {
+      // orbit[1] is the reference's c
+      const Complex c = orbit[1] + dc;
+      smooth = smoothIterations(iterations, z.real(), z.imag(), c.real(),
+                                c.imag());
+      if (distance) {
+        *distance = std::sqrt(r) * std::log(std::sqrt(r)) / std::abs(derivative);
+      }
+      break;
+    }
+    if (r < norm(dz) || m == orbitLength - 1) {
+      dz = z;
+      m = 0;
+    }
+  }
+  return iterations;
+}
+
+// center + centerLow + offset * spacing as a double-double, the high part
+// returned and the low one in low. offset is exact, a pixel plus a sample's
+// fraction of one.
+inline auto coordinate(double center, double centerLow, double offset,
+                       double spacing, double &low) -> double {
+  const double product = offset * spacing;
+  const double productError = std::fma(offset, spacing, -product);
+  const double sum = center + product;
+  const double v = sum - center;
+  const double error =
+      (center - (sum - v)) + (product - v) + productError + centerLow;
+  const double high = sum + error;
+  low = error - (high - sum);
+  return high;
+}
+
+// same as edge_tolerance in shader.comp.
+inline auto edgeTolerance(int maxIterations) -> int {
+  return std::max(1, maxIterations / 1024);
+}
+
+// a tile being rendered, local pixel p is (x0 + p % width, y0 + p / width).
+struct Tile {
+  static constexpr int capacity = CpuRenderer::tileSize * CpuRenderer::tileSize;
+  int x0, y0, width, height;
+  float *pixels;
+  int *periods;
+  int *keys;
+  int stride;
+  bool done[capacity] = {};
+
+  inline auto pixel(int p) const -> size_t {
+    return size_t(y0 + p / width) * stride + x0 + p % width;
+  }
+
+  // iteration count every sample of a pixel agreed on, edgeKey if they didn't
+  // or one saw the boundary pass through it.
+  inline auto key(int p) -> int & { return keys[pixel(p)]; }
+};
+
+// renders samples [first, last) of the listed pixels of a tile, blended
+// with the ones already there when first isn't 0.
+auto computePixels(const Frame &frame, Tile &tile, const int *list, int count,
+                   int first, int last) -> void {
+  // smooth counts of the samples that escaped, and how many did
+  double escapedSum[Tile::capacity];
+  int escaped[Tile::capacity];
+  std::fill_n(escapedSum, count, 0.0);
+  std::fill_n(escaped, count, 0);
+  // edges as in shader.comp, in units of c instead of pixels
+  const double edgeDistance = frame.spacing;
+
+  for (int i = first; i < last; i++) {
+    const double offsetX =
+        tile.x0 + frame.offsets[2 * i] - frame.width / 2.0;
+    const double offsetY =
+        tile.y0 + frame.offsets[2 * i + 1] - frame.height / 2.0;
+    int iterations[Tile::capacity];
+    int samplePeriods[Tile::capacity];
+    double distances[Tile::capacity];
+    double smooth[Tile::capacity];
+    std::fill_n(samplePeriods, count, 0);
+    std::fill_n(distances, count, std::numeric_limits<double>::infinity());
+
+    if (frame.perturb) {
+      for (int n = 0; n < count; n++) {
+        const int p = list[n];
+        const Complex delta =
+            frame.referenceOffset +
+            Complex{(p % tile.width + offsetX) * frame.spacing,
+                    (p / tile.width + offsetY) * frame.spacing};
+        iterations[n] = iteratePerturbed(
+            frame, delta, frame.adaptive ? &distances[n] : nullptr, smooth[n]);
+      }
+    } else {
+      // the rest of the pixels stream through the vector kernel in one
+      // batch, points in the cardioid or period 2 bulb are settled up front.
+      double cx[Tile::capacity], cy[Tile::capacity];
+      double cxLow[Tile::capacity], cyLow[Tile::capacity];
+      int batchIterations[Tile::capacity];
+      int batchPeriods[Tile::capacity];
+      double batchDistances[Tile::capacity];
+      double batchSmooth[Tile::capacity];
+      int slot[Tile::capacity];
+      int batch = 0;
+      // the deeper tiers iterate more of c than x and y round it to
+      const double margin =
+          frame.doubleDouble || frame.fixedPoint ? doubleBulbMargin : 0.0;
+      for (int n = 0; n < count; n++) {
+        const int p = list[n];
+        double x, y;
+        if (frame.doubleDouble) {
+          x = coordinate(frame.center.real(), frame.centerLow.real(),
+                         p % tile.width + offsetX, frame.spacing,
+                         cxLow[batch]);
+          y = coordinate(frame.center.imag(), frame.centerLow.imag(),
+                         p / tile.width + offsetY, frame.spacing,
+                         cyLow[batch]);
+        } else {
+          x = frame.center.real() + (p % tile.width + offsetX) * frame.spacing;
+          y = frame.center.imag() + (p / tile.width + offsetY) * frame.spacing;
+        }
+        if (const int period = insideMainBulbs(x, y, margin)) {
+          iterations[n] = frame.maxIterations;
+          smooth[n] = frame.maxIterations;
+          samplePeriods[n] = period;
+          continue;
+        }
+        if (frame.fixedPoint) {
+          // offsets from the centre, the kernel adds them in fixed point
+          cx[batch] = (p % tile.width + offsetX) * frame.spacing;
+          cy[batch] = (p / tile.width + offsetY) * frame.spacing;
+        } else {
+          cx[batch] = x;
+          cy[batch] = y;
+        }
+        slot[batch++] = n;
+      }
+      if (frame.fixedPoint) {
+        escapeTimeFixed(frame.fixedCenterX.data(), frame.fixedCenterY.data(),
+                        int(frame.fixedCenterX.size()), cx, cy,
+                        batchIterations, batchPeriods,
+                        frame.adaptive ? batchDistances : nullptr, batchSmooth,
+                        batch, frame.maxIterations, frame.periodTolerance);
+      } else if (frame.doubleDouble) {
+        escapeTimeDoubleDouble(cx, cxLow, cy, cyLow, batchIterations,
+                               batchPeriods,
+                               frame.adaptive ? batchDistances : nullptr,
+                               batchSmooth, batch, frame.maxIterations,
+                               frame.periodTolerance);
+      } else {
+        escapeTimeStreaming(cx, cy, batchIterations, batchPeriods,
+                            frame.adaptive ? batchDistances : nullptr,
+                            batchSmooth, batch, frame.maxIterations,
+                            frame.periodTolerance);
+      }
+      for (int b = 0; b < batch; b++) {
+        iterations[slot[b]] = batchIterations[b];
+        smooth[slot[b]] = batchSmooth[b];
+        samplePeriods[slot[b]] = batchPeriods[b];
+        if (frame.adaptive) {
+          distances[slot[b]] = batchDistances[b];
+        }
+      }
+    }
+
+    for (int n = 0; n < count; n++) {
+      const int p = list[n];
+      if (iterations[n] < frame.maxIterations) {
+        escapedSum[n] += smooth[n];
+        escaped[n]++;
+      }
+      if (first != 0) {
+        continue;
+      }
+      const int key =
+          distances[n] < edgeDistance ? CpuRenderer::edgeKey : iterations[n];
+      if (i == 0) {
+        tile.periods[tile.pixel(p)] = samplePeriods[n];
+        tile.key(p) = key;
+      } else if (tile.key(p) != key) {
+        tile.key(p) = CpuRenderer::edgeKey;
+      }
+    }
+  }
+
+  for (int n = 0; n < count; n++) {
+    float *out = &tile.pixels[tile.pixel(list[n]) * CpuRenderer::channels];
+    const double before = double(out[1]) * first;
+    const double total = before + escaped[n];
+    const double sum = double(out[0]) * before + escapedSum[n];
+    out[0] = total > 0.0 ? float(sum / total) : 0.0f;
+    out[1] = float(total / last);
+  }
+}
+
+struct Rect {
+  int x0, y0, x1, y1;
+};
+
+// Mariani-Silver: render the border of a rectangle, if every pixel on it
+// is in the set the inside can't hold anything else (the set is connected)
+// and gets filled, otherwise split in four and try again. Borders that
+// agree on an escape count aren't enough, the smooth counts within still
+// vary. Goes breadth first so all borders of a level share one batch, the
+// vector kernel needs plenty of points to keep its lanes full.
+auto subdivide(const Frame &frame, Tile &tile) -> void {
+  // too small to be worth another border.
+  constexpr int minimumSize = 6;
+  std::vector<Rect> rects{{0, 0, tile.width, tile.height}}, split;
+  int list[Tile::capacity];
+
+  while (!rects.empty()) {
+    int count = 0;
+    for (const Rect &rect : rects) {
+      for (int y = rect.y0; y < rect.y1; y++) {
+        const bool edge = y == rect.y0 || y == rect.y1 - 1;
+        for (int x = rect.x0; x < rect.x1;
+             x += edge || x == rect.x1 - 1 ? 1 : rect.x1 - 1 - rect.x0) {
+          const int p = y * tile.width + x;
+          if (!tile.done[p]) {
+            tile.done[p] = true;
+            list[count++] = p;
+          }
+        }
+      }
+    }
+    computePixels(frame, tile, list, count, 0, frame.samples);
+
+    // pixels of rectangles too small to split, rendered as one last batch.
+    int rest = 0;
+    split.clear();
+    for (const Rect &rect : rects) {
+      const int key = tile.key(rect.y0 * tile.width + rect.x0);
+      bool uniform = key == frame.maxIterations;
+      for (int x = rect.x0; x < rect.x1 && uniform; x++) {
+        uniform = tile.key(rect.y0 * tile.width + x) == key &&
+                  tile.key((rect.y1 - 1) * tile.width + x) == key;
+      }
+      for (int y = rect.y0; y < rect.y1 && uniform; y++) {
+        uniform = tile.key(y * tile.width + rect.x0) == key &&
+                  tile.key(y * tile.width + rect.x1 - 1) == key;
+      }
+
+      if (uniform) {
+        const size_t source = tile.pixel(rect.y0 * tile.width + rect.x0);
+        for (int y = rect.y0 + 1; y < rect.y1 - 1; y++) {
+          for (int x = rect.x0 + 1; x < rect.x1 - 1; x++) {
+            const int p = y * tile.width + x;
+            const size_t target = tile.pixel(p);
+            std::copy_n(&tile.pixels[source * CpuRenderer::channels],
+                        CpuRenderer::channels,
+                        &tile.pixels[target * CpuRenderer::channels]);
+            tile.periods[target] = tile.periods[source];
+            tile.key(p) = key;
+            tile.done[p] = true;
+          }
+        }
+      } else if (rect.x1 - rect.x0 <= minimumSize ||
+                 rect.y1 - rect.y0 <= minimumSize) {
+        for (int y = rect.y0 + 1; y < rect.y1 - 1; y++) {
+          for (int x = rect.x0 + 1; x < rect.x1 - 1; x++) {
+            const int p = y * tile.width + x;
+            if (!tile.done[p]) {
+              tile.done[p] = true;
+              list[rest++] = p;
+            }
+          }
+        }
+      } else {
+        // the quarters share their middle row and column.
+        const int mx = (rect.x0 + rect.x1) / 2;
+        const int my = (rect.y0 + rect.y1) / 2;
+        split.push_back({rect.x0, rect.y0, mx + 1, my + 1});
+        split.push_back({mx, rect.y0, rect.x1, my + 1});
+        split.push_back({rect.x0, my, mx + 1, rect.y1});
+        split.push_back({mx, my, rect.x1, rect.y1});
+      }
+    }
+    computePixels(frame, tile, list, rest, 0, frame.samples);
+    std::swap(rects, split);
+  }
+}
+
+} // namespace
+
+auto CpuRenderer::render(const Frame &frame) -> void {
+  frameBuffers(frame.width, frame.height);
+  Frame pass = frame;
+  // the first adaptive pass only takes the first sample
+  if (frame.adaptive && frame.samples > 1) {
+    pass.samples = 1;
+  } else {
+    pass.adaptive = false;
+  }
+  forEachTile(pass, [&](int x0, int y0, int x1, int y1) {
+    renderTile(pass, x0, y0, x1, y1);
+  });
+}
+
+auto CpuRenderer::refine(const Frame &frame) -> void {
+  if (!frame.adaptive || frame.samples == 1) {
+    return;
+  }
+  Frame pass = frame;
+  pass.adaptive = false;
+  forEachTile(pass, [&](int x0, int y0, int x1, int y1) {
+    refineTile(pass, x0, y0, x1, y1);
+  });
+}
+
+auto CpuRenderer::shift(int dx, int dy) -> void {
+  const auto move = [&](auto &buffer, size_t channels) {
+    const int height = width ? int(buffer.size() / channels / width) : 0;
+    const int columns = width - std::abs(dx);
+    if (columns <= 0 || std::abs(dy) >= height) {
+      return;
+    }
+    // go against the direction of the move so rows aren't overwritten
+    // before they are copied.
+    for (int i = 0; i < height - std::abs(dy); i++) {
+      const int y = dy > 0 ? i : height - 1 - i;
+      auto *source = &buffer[(size_t(y + dy) * width + std::max(dx, 0)) * channels];
+      auto *target = &buffer[(size_t(y) * width + std::max(-dx, 0)) * channels];
+      std::memmove(target, source, columns * channels * sizeof(buffer[0]));
+    }
+  };
+  move(pixels, channels);
+  move(periods, 1);
+  move(keys, 1);
+}
+
+auto CpuRenderer::reproject(double scale, double offsetX, double offsetY,
+                            bool keep, int maxIterations) -> void {
+  const int height = width ? int(periods.size()) / width : 0;
+  previousPixels = pixels;
+  previousPeriods = periods;
+  previousKeys = keys;
+  const double halfWidth = width / 2.0;
+  const double halfHeight = height / 2.0;
+  const int taps = std::clamp(int(std::ceil(scale)), 1, 4);
+  pool.run(size_t(height), [&](size_t row, size_t) {
+    const int y = int(row);
+    const double lowY = (y - halfHeight) * scale + halfHeight + offsetY;
+    for (int x = 0; x < width; x++) {
+      const size_t target = size_t(y) * width + x;
+      const double lowX = (x - halfWidth) * scale + halfWidth + offsetX;
+      float *out = &pixels[target * channels];
+      if (lowX < 0.0 || lowY < 0.0 || lowX + scale > width ||
+          lowY + scale > height) {
+        std::fill_n(out, channels, 0.0f);
+        periods[target] = 0;
+        keys[target] = emptyKey;
+        continue;
+      }
+      const size_t middle =
+          size_t(lowY + scale / 2.0) * width + size_t(lowX + scale / 2.0);
+      // weighted like the samples the source pixels averaged
+      double sum = 0.0, escaped = 0.0;
+      for (int ty = 0; ty < taps; ty++) {
+        for (int tx = 0; tx < taps; tx++) {
+          const int sx = int(lowX + (tx + 0.5) / taps * scale);
+          const int sy = int(lowY + (ty + 0.5) / taps * scale);
+          const size_t source = size_t(sy) * width + sx;
+          const float *in = &previousPixels[source * channels];
+          // past the new maxIterations, what escaped is inside now
+          if (keep && in[0] >= float(maxIterations)) {
+            continue;
+          }
+          sum += double(in[0]) * in[1];
+          escaped += in[1];
+        }
+      }
+      out[0] = escaped > 0.0 ? float(sum / escaped) : 0.0f;
+      out[1] = float(escaped / (taps * taps));
+      periods[target] = previousPeriods[middle];
+      // zooming again before render got there keeps the gaps empty
+      keys[target] =
+          previousKeys[middle] == emptyKey ? emptyKey : previewKey;
+    }
+  });
+}
+
+auto CpuRenderer::frameBuffers(int width, int height) -> FrameBuffers {
+  this->width = width;
+  pixels.resize(size_t(width) * height * channels);
+  periods.resize(size_t(width) * height);
+  keys.resize(size_t(width) * height);
+  return {pixels.data(), periods.data(), keys.data(), width};
+}
+
+auto CpuRenderer::histogram(int maxIterations, int bins)
+    -> std::vector<uint32_t> {
+  // every worker counts rows into its own bins, they're summed at the end.
+  std::vector<std::vector<uint32_t>> counts(
+      pool.size() + 1, std::vector<uint32_t>(size_t(bins), 0));
+  const int height = width ? int(periods.size()) / width : 0;
+  const int last = bins - 1;
+  pool.run(size_t(height), [&](size_t row, size_t worker) {
+    uint32_t *bin = counts[worker].data();
+    const float *value = &pixels[row * width * channels];
+    for (int x = 0; x < width; x++, value += channels) {
+      if (value[1] > 0.0f) {
+        bin[std::min(last,
+                     int(value[0] / float(maxIterations) * float(last)))]++;
+      }
+    }
+  });
+  for (size_t w = 1; w < counts.size(); w++) {
+    for (int i = 0; i < bins; i++) {
+      counts[0][i] += counts[w][i];
+    }
+  }
+  return counts[0];
+}
+
+auto CpuRenderer::forEachTile(
+    const Frame &frame, const std::function<void(int, int, int, int)> &task)
+    -> void {
+  const bool region = frame.x1 > frame.x0 && frame.y1 > frame.y0;
+  const int x0 = region ? frame.x0 : 0;
+  const int y0 = region ? frame.y0 : 0;
+  const int x1 = region ? frame.x1 : frame.width;
+  const int y1 = region ? frame.y1 : frame.height;
+  // tiles stay on the frame's grid so they start on multiples of every
+  // stride, the region just clips them.
+  const int tileX0 = x0 / tileSize;
+  const int tileY0 = y0 / tileSize;
+  const int tilesX = (x1 + tileSize - 1) / tileSize - tileX0;
+  const int tilesY = (y1 + tileSize - 1) / tileSize - tileY0;
+  pool.run(size_t(tilesX) * tilesY, [&](size_t tile, size_t) {
+    if (frame.cancelled && frame.cancelled->load(std::memory_order_relaxed)) {
+      return;
+    }
+    const int tileX = (tileX0 + int(tile % tilesX)) * tileSize;
+    const int tileY = (tileY0 + int(tile / tilesX)) * tileSize;
+    task(std::max(tileX, x0), std::max(tileY, y0),
+         std::min(tileX + tileSize, x1), std::min(tileY + tileSize, y1));
+  });
+}
+
+auto CpuRenderer::renderTile(const Frame &frame, int x0, int y0, int x1,
+                             int y1) -> void {
+  Tile tile{x0, y0, x1 - x0, y1 - y0, pixels.data(), periods.data(),
+            keys.data(), frame.width};
+
+  // tiles start on multiples of every stride, local coordinates do.
+  const int stride = frame.stride;
+  int list[Tile::capacity];
+  int count = 0;
+  for (int y = 0; y < tile.height; y++) {
+    for (int x = 0; x < tile.width; x++) {
+      const int p = y * tile.width + x;
+      const bool coarse = x % (2 * stride) == 0 && y % (2 * stride) == 0;
+      if (x % stride == 0 && y % stride == 0 && !(frame.skipCoarse && coarse)) {
+        list[count++] = p;
+      } else {
+        tile.done[p] = true;
+      }
+    }
+  }
+
+  if (frame.subdivide && stride == 1) {
+    // whatever the coarse pass did counts as rendered already.
+    subdivide(frame, tile);
+    return;
+  }
+  computePixels(frame, tile, list, count, 0, frame.samples);
+  if (stride == 1) {
+    return;
+  }
+  for (int n = 0; n < count; n++) {
+    const int x = list[n] % tile.width;
+    const int y = list[n] / tile.width;
+    const size_t source = tile.pixel(list[n]);
+    for (int by = y; by < std::min(y + stride, tile.height); by++) {
+      for (int bx = x; bx < std::min(x + stride, tile.width); bx++) {
+        const size_t target = tile.pixel(by * tile.width + bx);
+        // a preview beats a coarse block, see store_pixel in shader.comp
+        if (target == source ||
+            (frame.keepPreview && keys[target] != emptyKey)) {
+          continue;
+        }
+        std::copy_n(&pixels[source * channels], channels,
+                    &pixels[target * channels]);
+        periods[target] = periods[source];
+      }
+    }
+  }
+}
+
+auto CpuRenderer::refineTile(const Frame &frame, int x0, int y0, int x1,
+                             int y1) -> void {
+  Tile tile{x0, y0, x1 - x0, y1 - y0, pixels.data(), periods.data(),
+            keys.data(), frame.width};
+
+  const int tolerance = edgeTolerance(frame.maxIterations);
+  int list[Tile::capacity];
+  int count = 0;
+  for (int y = y0; y < y1; y++) {
+    for (int x = x0; x < x1; x++) {
+      const int key = keys[size_t(y) * frame.width + x];
+      bool edge = key < 0;
+      for (int ny = std::max(0, y - 1); ny <= std::min(frame.height - 1, y + 1);
+           ny++) {
+        for (int nx = std::max(0, x - 1);
+             nx <= std::min(frame.width - 1, x + 1) && !edge; nx++) {
+          const int neighbour = keys[size_t(ny) * frame.width + nx];
+          edge = neighbour < 0 || std::abs(neighbour - key) > tolerance;
+        }
+      }
+      if (edge) {
+        list[count++] = (y - y0) * tile.width + x - x0;
+      }
+    }
+  }
+  computePixels(frame, tile, list, count, 1, frame.samples);
+}
+
+} // namespace mandelbrot
@@ -0,0 +1,133 @@
+#pragma once
+#include <atomic>
+#include <complex>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "perturbation.hpp"
+#include "simd_kernel.hpp"
+#include "thread_pool.hpp"
+#include "tile_cache.hpp"
+
+namespace mandelbrot {
+
+// Everything the kernels need for one frame, the CPU side mirror of the
+// uniforms and buffers shader.comp gets.
+struct Frame {
+  int width = 0;
+  int height = 0;
+  // pixel -> offset from the centre is (pixel - size / 2) * spacing
+  double spacing = 0.0;
+  std::complex<double> center;
+  bool perturb = false;
+  // iterate in double-doubles, with centerLow the rest of the centre the
+  // doubles above leave out. see escapeTimeDoubleDouble.
+  bool doubleDouble = false;
+  std::complex<double> centerLow;
+  // iterate in fixed point around the centre in these limbs, see
+  // BigFixed::twosComplement and escapeTimeFixed.
+  bool fixedPoint = false;
+  std::vector<uint32_t> fixedCenterX;
+  std::vector<uint32_t> fixedCenterY;
+  const ReferenceOrbit *orbit = nullptr;
+  // the centre less the orbit's, see ReferenceOrbit::offset
+  std::complex<double> referenceOffset;
+  const SeriesApproximation *series = nullptr;
+  const BlaTable *bla = nullptr;
+  int maxIterations = 0;
+  // squared distance at which an orbit counts as having returned to a point
+  double periodTolerance = 0.0;
+  int samples = 1;
+  // samples (x, y) pairs of sub pixel offsets
+  const float *offsets = nullptr;
+  // fill rectangles with a uniform border instead of rendering them.
+  bool subdivide = false;
+  // take one sample per pixel, then the others only around edges in refine.
+  bool adaptive = false;
+  // progressive refinement: only every stride-th pixel in x and y is
+  // rendered, and stands in for its stride x stride block. skipCoarse leaves
+  // out the ones at twice the stride, the pass before had them.
+  int stride = 1;
+  bool skipCoarse = false;
+  // leave pixels with a preview alone instead of painting blocks over them.
+  bool keepPreview = false;
+  // part of the frame to render, [x0, x1) x [y0, y1). all of it when empty.
+  int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+  // once set, tiles that haven't started yet are left as they are.
+  const std::atomic<bool> *cancelled = nullptr;
+};
+
+// what the CPU iterates in where precisionFor picks a tier: doubles for
+// the float tiers it has no kernels for, perturbation past the limbs of its
+// fixed point kernels.
+inline auto cpuPrecision(double spacing, int fixedLimbs, bool reference)
+    -> Precision {
+  const Precision precision = precisionFor(spacing, true, reference);
+  if (precision == Precision::float32) {
+    return Precision::float64;
+  }
+  if (precision == Precision::fixedPoint && fixedLimbs > maxFixedLimbs) {
+    return Precision::perturbed;
+  }
+  return precision;
+}
+
+// Native port of shader.comp for machines without a usable GPU. The frame is
+// cut into tiles which the pool's workers pull (and steal) until done.
+struct CpuRenderer {
+  static constexpr int tileSize = 32;
+  // keys besides iteration counts, same as in shader.comp
+  static constexpr int edgeKey = -1;
+  static constexpr int previewKey = -2;
+  static constexpr int emptyKey = -3;
+
+  CpuRenderer() = default;
+  // a background renderer's workers only take cores nothing else wants
+  explicit CpuRenderer(bool background)
+      : pool(std::thread::hardware_concurrency(), background) {}
+
+  // per pixel the mean smooth count (see smoothIterations) of the samples
+  // that escaped and the fraction of them that did, see shader.frag for the
+  // colours. rows bottom up like the texture it gets uploaded to.
+  static constexpr int channels = 2;
+  std::vector<float> pixels;
+  // cycle length of each pixel's first sample, 0 if it has none.
+  std::vector<int> periods;
+
+  auto render(const Frame &frame) -> void;
+  // second adaptive pass, after render has been through the whole frame.
+  auto refine(const Frame &frame) -> void;
+  // moves what's been rendered by (dx, dy) pixels, for panning. the pixels
+  // it uncovers are left for render to fill in.
+  auto shift(int dx, int dy) -> void;
+  // resamples what's been rendered as a preview of a zoomed (and moved)
+  // view, keep for zooming out of a finished frame, see reproject_pixel in
+  // shader.comp.
+  auto reproject(double scale, double offsetX, double offsetY,
+                 bool keep, int maxIterations) -> void;
+  // histogram of the pixels with escaped samples, binned like
+  // histogram.comp does.
+  auto histogram(int maxIterations, int bins) -> std::vector<uint32_t>;
+  // all of the buffers, sized for a width x height frame, for the tile
+  // cache to copy tiles in and out.
+  auto frameBuffers(int width, int height) -> FrameBuffers;
+
+private:
+  ThreadPool pool;
+
+  // see Tile in cpu_renderer.cpp
+  std::vector<int> keys;
+  // of the last frame rendered
+  int width = 0;
+  std::vector<float> previousPixels;
+  std::vector<int> previousPeriods;
+  std::vector<int> previousKeys;
+
+  auto forEachTile(const Frame &frame,
+                   const std::function<void(int, int, int, int)> &task) -> void;
+  auto renderTile(const Frame &frame, int x0, int y0, int x1, int y1) -> void;
+  auto refineTile(const Frame &frame, int x0, int y0, int x1, int y1) -> void;
+};
+
+} // namespace mandelbrot
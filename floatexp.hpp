@@ -0,0 +1,111 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace mandelbrot {
+
+// A double mantissa paired with a wide binary exponent. Used for quantities
+// like the pixel spacing that leave the range of a plain double long before
+// the view centre runs out of precision.
+struct FloatExp {
+  double mantissa = 0.0; // 0 or |mantissa| in [0.5, 1)
+  int64_t exponent = 0;
+
+  FloatExp() = default;
+  FloatExp(double value) {
+    int e = 0;
+    mantissa = std::frexp(value, &e);
+    exponent = mantissa == 0.0 ? 0 : e;
+  }
+  FloatExp(double m, int64_t e) : mantissa(m), exponent(e) { normalize(); }
+
+  inline auto normalize() -> void {
+    if (mantissa == 0.0) {
+      exponent = 0;
+      return;
+    }
+    int e = 0;
+    mantissa = std::frexp(mantissa, &e);
+    exponent += e;
+  }
+
+  // clamps to zero / infinity outside of the range of a double.
+  inline auto toDouble() const -> double {
+    if (exponent < std::numeric_limits<double>::min_exponent - 53) {
+      return 0.0;
+    }
+    if (exponent > std::numeric_limits<double>::max_exponent) {
+      return std::copysign(std::numeric_limits<double>::infinity(), mantissa);
+    }
+    return std::ldexp(mantissa, int(exponent));
+  }
+
+  inline auto log2() const -> double {
+    return std::log2(std::abs(mantissa)) + double(exponent);
+  }
+  inline auto log() const -> double { return log2() * 0.6931471805599453; }
+
+  inline auto abs() const -> FloatExp {
+    return {std::abs(mantissa), exponent};
+  }
+
+  inline auto sqrt() const -> FloatExp {
+    // make the exponent even so it halves exactly.
+    double m = mantissa;
+    int64_t e = exponent;
+    if (e & 1) {
+      m *= 2.0;
+      e -= 1;
+    }
+    return {std::sqrt(m), e / 2};
+  }
+
+  // multiply by 2^n.
+  inline auto ldexp(int64_t n) const -> FloatExp {
+    return mantissa == 0.0 ? FloatExp{} : FloatExp{mantissa, exponent + n};
+  }
+
+  inline auto operator-() const -> FloatExp { return {-mantissa, exponent}; }
+
+  friend inline auto operator*(FloatExp a, FloatExp b) -> FloatExp {
+    return {a.mantissa * b.mantissa, a.exponent + b.exponent};
+  }
+  friend inline auto operator/(FloatExp a, FloatExp b) -> FloatExp {
+    return {a.mantissa / b.mantissa, a.exponent - b.exponent};
+  }
+  friend inline auto operator+(FloatExp a, FloatExp b) -> FloatExp {
+    if (a.mantissa == 0.0) {
+      return b;
+    }
+    if (b.mantissa == 0.0) {
+      return a;
+    }
+    if (a.exponent < b.exponent) {
+      std::swap(a, b);
+    }
+    const int64_t shift = a.exponent - b.exponent;
+    if (shift > 60) {
+      return a;
+    }
+    return {a.mantissa + std::ldexp(b.mantissa, -int(shift)), a.exponent};
+  }
+  friend inline auto operator-(FloatExp a, FloatExp b) -> FloatExp {
+    return a + -b;
+  }
+
+  friend inline auto operator<(FloatExp a, FloatExp b) -> bool {
+    return (a - b).mantissa < 0.0;
+  }
+  friend inline auto operator>(FloatExp a, FloatExp b) -> bool {
+    return b < a;
+  }
+  friend inline auto operator==(FloatExp a, FloatExp b) -> bool {
+    return a.mantissa == b.mantissa && a.exponent == b.exponent;
+  }
+
+  inline auto operator*=(FloatExp o) -> FloatExp & { return *this = *this * o; }
+  inline auto operator/=(FloatExp o) -> FloatExp & { return *this = *this / o; }
+};
+
+} // namespace mandelbrot
@@ -0,0 +1,173 @@
+#pragma once
+// clang-format off
+#include <GL/glew.h>
+#include <GL/gl.h>
+// clang-format on
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <glm/glm.hpp>
+
+namespace mandelbrot {
+
+// uniforms the Shader wrapper has no setter for, set on the bound program.
+// they work the same on a ComputeVariant's.
+inline auto uniformLocation(const char *name) -> GLint {
+  GLint program = 0;
+  glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+  return glGetUniformLocation(program, name);
+}
+
+inline auto setUniform(const char *name, int value) -> void {
+  glUniform1i(uniformLocation(name), value);
+}
+
+inline auto setUniform(const char *name, float value) -> void {
+  glUniform1f(uniformLocation(name), value);
+}
+
+inline auto setUniform(const char *name, double value) -> void {
+  glUniform1d(uniformLocation(name), value);
+}
+
+inline auto setUniform(const char *name, double x, double y) -> void {
+  glUniform2d(uniformLocation(name), x, y);
+}
+
+inline auto setUniform(const char *name, int x, int y) -> void {
+  glUniform2i(uniformLocation(name), x, y);
+}
+
+inline auto setUniform(const char *name, const int *values, int count)
+    -> void {
+  glUniform1iv(uniformLocation(name), count, values);
+}
+
+inline auto setUniform(const char *name, const uint32_t *values, int count)
+    -> void {
+  glUniform1uiv(uniformLocation(name), count, values);
+}
+
+inline auto setUniform(const char *name, bool value) -> void {
+  glUniform1i(uniformLocation(name), value);
+}
+
+inline auto setUniform(const char *name, glm::vec2 value) -> void {
+  glUniform2f(uniformLocation(name), value.x, value.y);
+}
+
+inline auto setUniform(const char *name, const glm::vec2 *values, int count)
+    -> void {
+  glUniform2fv(uniformLocation(name), count, &values[0].x);
+}
+
+inline auto setUniform(const char *name, const glm::dmat4 &value) -> void {
+  glUniformMatrix4dv(uniformLocation(name), 1, GL_FALSE, &value[0][0]);
+}
+
+// moves the texels of a 2d texture by (dx, dy), texel (x, y) ends up with
+// what was at (x + dx, y + dy) and what nothing lands on keeps its old
+// value. the copy can't overlap itself, so it goes through scratch, which
+// needs to be as large and of a compatible format.
+inline auto shiftTexture(GLuint texture, GLuint scratch, int width, int height,
+                         int dx, int dy) -> void {
+  const int columns = width - std::abs(dx);
+  const int rows = height - std::abs(dy);
+  if (columns <= 0 || rows <= 0) {
+    return;
+  }
+  glCopyImageSubData(texture, GL_TEXTURE_2D, 0, std::max(dx, 0),
+                     std::max(dy, 0), 0, scratch, GL_TEXTURE_2D, 0, 0, 0, 0,
+                     columns, rows, 1);
+  glCopyImageSubData(scratch, GL_TEXTURE_2D, 0, 0, 0, 0, texture,
+                     GL_TEXTURE_2D, 0, std::max(-dx, 0), std::max(-dy, 0), 0,
+                     columns, rows, 1);
+}
+
+// A compute program built from the shader at path with defines put in right
+// after its #version line, for variants of a shader the Shader wrapper can
+// only load as it is. id is 0 if it didn't build.
+struct ComputeVariant {
+  ComputeVariant(const char *path, const std::string &defines) {
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string source = contents.str();
+    const size_t versionEnd = source.find('\n');
+    if (!file || versionEnd == std::string::npos) {
+      std::cerr << "Could not read shader " << path << std::endl;
+      return;
+    }
+    source.insert(versionEnd + 1, defines);
+
+    const GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+    const char *text = source.c_str();
+    glShaderSource(shader, 1, &text, nullptr);
+    glCompileShader(shader);
+    GLint status = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+      char log[4096];
+      glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+      std::cerr << "Failed to compile " << path << " with\n"
+                << defines << log << std::endl;
+      glDeleteShader(shader);
+      return;
+    }
+    id = glCreateProgram();
+    glAttachShader(id, shader);
+    glLinkProgram(id);
+    glDeleteShader(shader);
+    glGetProgramiv(id, GL_LINK_STATUS, &status);
+    if (!status) {
+      char log[4096];
+      glGetProgramInfoLog(id, sizeof(log), nullptr, log);
+      std::cerr << "Failed to link " << path << " with\n"
+                << defines << log << std::endl;
+      glDeleteProgram(id);
+      id = 0;
+    }
+  }
+  ~ComputeVariant() { glDeleteProgram(id); }
+  ComputeVariant(const ComputeVariant &) = delete;
+  auto operator=(const ComputeVariant &) -> ComputeVariant & = delete;
+
+  inline auto use() const -> void { glUseProgram(id); }
+
+  GLuint id = 0;
+};
+
+// a shader storage buffer that grows to fit whatever is uploaded.
+struct StorageBuffer {
+  StorageBuffer() { glGenBuffers(1, &id); }
+  ~StorageBuffer() { glDeleteBuffers(1, &id); }
+  StorageBuffer(const StorageBuffer &) = delete;
+  auto operator=(const StorageBuffer &) -> StorageBuffer & = delete;
+
+  inline auto upload(const void *data, size_t bytes) -> void {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
+    if (bytes > capacity) {
+      glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, data, GL_DYNAMIC_DRAW);
+      capacity = bytes;
+    } else {
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, data);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+
+  inline auto bind(GLuint binding) const -> void {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, id);
+  }
+
+  GLuint id = 0;
+  size_t capacity = 0;
+};
+
+} // namespace mandelbrot
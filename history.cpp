@@ -0,0 +1,142 @@
+#include "history.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+namespace mandelbrot {
+
+namespace {
+
+constexpr uint32_t runBit = 0x8000'0000u;
+// shorter repeats aren't worth a packet of their own
+constexpr size_t shortestRun = 3;
+
+// the count words at word(0), word(1), ...
+template <typename Word>
+auto encode(std::vector<uint32_t> &words, size_t count, Word word) -> void {
+  const auto runAt = [&](size_t i) {
+    size_t length = 1;
+    while (i + length < count && word(i + length) == word(i) &&
+           length < ~runBit) {
+      length++;
+    }
+    return length;
+  };
+  for (size_t i = 0; i < count;) {
+    const size_t run = runAt(i);
+    if (run >= shortestRun) {
+      words.push_back(uint32_t(run) | runBit);
+      words.push_back(word(i));
+      i += run;
+      continue;
+    }
+    // as they are, up to where a run starts
+    const size_t header = words.size();
+    words.push_back(0);
+    const size_t start = i;
+    while (i < count && i - start < ~runBit &&
+           (i + shortestRun > count || runAt(i) < shortestRun)) {
+      words.push_back(word(i));
+      i++;
+    }
+    words[header] = uint32_t(i - start);
+  }
+}
+
+template <typename Store>
+auto decode(const uint32_t *&words, size_t count, Store store) -> void {
+  for (size_t i = 0; i < count;) {
+    const uint32_t header = *words++;
+    const size_t length = header & ~runBit;
+    if (header & runBit) {
+      const uint32_t word = *words++;
+      for (size_t end = i + length; i < end; i++) {
+        store(i, word);
+      }
+    } else {
+      for (size_t end = i + length; i < end; i++) {
+        store(i, *words++);
+      }
+    }
+  }
+}
+
+} // namespace
+
+auto Snapshot::capture(const FrameBuffers &frame, int height) -> Snapshot {
+  Snapshot snapshot;
+  snapshot.width = frame.width;
+  snapshot.height = height;
+  const size_t pixels = size_t(frame.width) * height;
+  for (int channel = 0; channel < 2; channel++) {
+    encode(snapshot.words, pixels, [&](size_t i) {
+      return std::bit_cast<uint32_t>(frame.values[i * 2 + channel]);
+    });
+  }
+  encode(snapshot.words, pixels,
+         [&](size_t i) { return uint32_t(frame.periods[i]); });
+  encode(snapshot.words, pixels,
+         [&](size_t i) { return uint32_t(frame.keys[i]); });
+  snapshot.words.shrink_to_fit();
+  return snapshot;
+}
+
+auto Snapshot::restore(const FrameBuffers &frame) const -> void {
+  const size_t pixels = size_t(width) * height;
+  const uint32_t *word = words.data();
+  for (int channel = 0; channel < 2; channel++) {
+    decode(word, pixels, [&](size_t i, uint32_t value) {
+      frame.values[i * 2 + channel] = std::bit_cast<float>(value);
+    });
+  }
+  decode(word, pixels,
+         [&](size_t i, uint32_t value) { frame.periods[i] = int(value); });
+  decode(word, pixels,
+         [&](size_t i, uint32_t value) { frame.keys[i] = int(value); });
+}
+
+auto History::record(HistoryEntry entry) -> void {
+  used += entry.snapshot.bytes();
+  if (!entries.empty() && entries[current].view == entry.view &&
+      entries[current].samplesPerAxis == entry.samplesPerAxis) {
+    used -= entries[current].snapshot.bytes();
+    entries[current] = std::move(entry);
+  } else {
+    while (entries.size() > current + 1) {
+      used -= entries.back().snapshot.bytes();
+      entries.pop_back();
+    }
+    entries.push_back(std::move(entry));
+    current = entries.size() - 1;
+  }
+  while (current > 0 && (entries.size() > capacity || used > budget)) {
+    used -= entries.front().snapshot.bytes();
+    entries.pop_front();
+    current--;
+  }
+}
+
+auto History::back(const View &view, int samplesPerAxis)
+    -> const HistoryEntry * {
+  if (entries.empty()) {
+    return nullptr;
+  }
+  if (!(entries[current].view == view) ||
+      entries[current].samplesPerAxis != samplesPerAxis) {
+    return &entries[current];
+  }
+  if (current == 0) {
+    return nullptr;
+  }
+  return &entries[--current];
+}
+
+auto History::forward() -> const HistoryEntry * {
+  if (current + 1 >= entries.size()) {
+    return nullptr;
+  }
+  return &entries[++current];
+}
+
+} // namespace mandelbrot
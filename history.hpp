@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "tile_cache.hpp"
+#include "view.hpp"
+
+namespace mandelbrot {
+
+// A whole frame's buffers, run length encoded: interior and the smooth
+// bands outside the set are long runs of the same word. Every channel is
+// encoded on its own, as packets of a header word and its payload: a run
+// of (header & ~runBit) copies of one word, or that many words as they are.
+struct Snapshot {
+  int width = 0;
+  int height = 0;
+  std::vector<uint32_t> words;
+
+  static auto capture(const FrameBuffers &frame, int height) -> Snapshot;
+  // frame needs to be as big as the one captured.
+  auto restore(const FrameBuffers &frame) const -> void;
+  inline auto bytes() const -> size_t {
+    return words.size() * sizeof(words[0]);
+  }
+};
+
+// A view that was on screen, with what to restore it from.
+struct HistoryEntry {
+  View view;
+  int samplesPerAxis = 1;
+  int maxIterations = 0;
+  // as for the tile cache, what else the pixels depend on
+  uint64_t formula = 0;
+  Snapshot snapshot;
+};
+
+// The last views that were finished on screen, like a browser's: going back
+// and recording a new view drops the ones ahead. Only the newest are kept,
+// no more than capacity of them and budget bytes of snapshots, the oldest
+// are evicted first. The current one stays whatever its size.
+struct History {
+  static constexpr size_t capacity = 32;
+
+  explicit History(size_t budget = size_t(128) << 20) : budget(budget) {}
+
+  // a new entry after the current one, or in its place if that shows the
+  // same view.
+  auto record(HistoryEntry entry) -> void;
+  // the entry before the current one, or the current one if the view on
+  // screen moved away from it. nullptr if there isn't any. entries stay
+  // valid until the next record.
+  auto back(const View &view, int samplesPerAxis) -> const HistoryEntry *;
+  auto forward() -> const HistoryEntry *;
+
+private:
+  std::deque<HistoryEntry> entries;
+  size_t current = 0;
+  size_t budget;
+  size_t used = 0;
+};
+
+} // namespace mandelbrot
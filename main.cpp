@@ -4,6 +4,10 @@
 #include <GLFW/glfw3.h>
 // clang-format on
 
+#include <fstream>
+#include <iterator>
+#include <map>
+
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/ext/quaternion_transform.hpp>
@@ -20,9 +24,20 @@
 #include <jstl/opengl/shader.hpp>
 #include <jstl/opengl/window.hpp>
 
+#include "cpu_renderer.hpp"
 #include "font.hpp"
+#include "gl_util.hpp"
+#include "history.hpp"
+#include "palette.hpp"
+#include "perturbation.hpp"
+#include "prefetch.hpp"
+#include "simd_kernel.hpp"
+#include "tile_cache.hpp"
+#include "tile_store.hpp"
+#include "view.hpp"
 
 using namespace jstl::opengl;
+using namespace mandelbrot;
 
 int main() {
 
@@ -30,12 +45,35 @@ int main() {
 
   Shader shader("shader.vert", "shader.frag");
   Shader computeShader("shader.comp");
+  // shader.comp with the fixed point tier, by limb count. built the first
+  // time a view needs them.
+  std::map<int, ComputeVariant> fixedPointShaders;
+  Shader histogramShader("histogram.comp");
+  Shader transferShader("transfer.comp");
 
   font::FontRenderer fontRenderer{};
   fontRenderer.setViewport(window.resolution);
 
   FullScreenQuad fullscreenQuad(&shader);
-  GLuint framebufferTexture;
+  // what the kernels produce, shader.frag colours it with the palette.
+  // with the period and key textures below that's 16 bytes a pixel, 32 with
+  // the previous copies, twice the RGBA32F image colours used to be iterated
+  // into. nothing narrower holds them: smooth counts past 2048 iterations
+  // need float32, keys and periods go up to maxIterations, past 16 bits at
+  // depth. what keeping them apart from the colours buys is recolouring
+  // without iterating again, not bandwidth.
+  GLuint iterationTexture;
+  GLuint paletteTexture;
+  // palette position of every iteration count, see transferTable
+  GLuint transferTexture;
+  GLuint periodTexture;
+  // first sample key of each pixel, see shader.comp
+  GLuint keyTexture;
+  // the frame before a zoom for reproject_pixel in shader.comp, also the
+  // scratch copies go through when panning shifts the ones above
+  GLuint previousTexture;
+  GLuint previousPeriodTexture;
+  GLuint previousKeyTexture;
 
   window.setClearColor(glm::vec4(0, 0, 0, 1));
 
@@ -45,26 +83,250 @@ int main() {
 
   // Initialize framebuffer texture
   {
-    glGenTextures(1, &framebufferTexture);
-    glBindTexture(GL_TEXTURE_2D, framebufferTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, window.resolution.x,
-                 window.resolution.y, 0, GL_RGBA, GL_FLOAT, nullptr);
+    glGenTextures(1, &iterationTexture);
+    glBindTexture(GL_TEXTURE_2D, iterationTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, window.resolution.x,
+                 window.resolution.y, 0, GL_RG, GL_FLOAT, nullptr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    const std::vector<float> palette = sinPalette(1024);
+    glGenTextures(1, &paletteTexture);
+    glBindTexture(GL_TEXTURE_1D, paletteTexture);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB32F, GLsizei(palette.size() / 3), 0,
+                 GL_RGB, GL_FLOAT, palette.data());
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+
+    glGenTextures(1, &transferTexture);
+    glBindTexture(GL_TEXTURE_1D, transferTexture);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_R32F, histogramBins, 0, GL_RED,
+                 GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_1D, 0);
+
+    glGenTextures(1, &periodTexture);
+    glBindTexture(GL_TEXTURE_2D, periodTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32I, window.resolution.x,
+                 window.resolution.y, 0, GL_RED_INTEGER, GL_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &keyTexture);
+    glBindTexture(GL_TEXTURE_2D, keyTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32I, window.resolution.x,
+                 window.resolution.y, 0, GL_RED_INTEGER, GL_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &previousTexture);
+    glBindTexture(GL_TEXTURE_2D, previousTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, window.resolution.x,
+                 window.resolution.y, 0, GL_RG, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &previousPeriodTexture);
+    glBindTexture(GL_TEXTURE_2D, previousPeriodTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32I, window.resolution.x,
+                 window.resolution.y, 0, GL_RED_INTEGER, GL_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &previousKeyTexture);
+    glBindTexture(GL_TEXTURE_2D, previousKeyTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32I, window.resolution.x,
+                 window.resolution.y, 0, GL_RED_INTEGER, GL_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   }
 
   window.resizeEvent().subscribe([&](int x, int y) {
-    glBindTexture(GL_TEXTURE_2D, framebufferTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, x, y, 0, GL_RGBA, GL_FLOAT,
+    glBindTexture(GL_TEXTURE_2D, iterationTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, x, y, 0, GL_RG, GL_FLOAT,
                  nullptr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, periodTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32I, x, y, 0, GL_RED_INTEGER, GL_INT,
+                 nullptr);
+    glBindTexture(GL_TEXTURE_2D, keyTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32I, x, y, 0, GL_RED_INTEGER, GL_INT,
+                 nullptr);
+    glBindTexture(GL_TEXTURE_2D, previousTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, x, y, 0, GL_RG, GL_FLOAT,
+                 nullptr);
+    glBindTexture(GL_TEXTURE_2D, previousPeriodTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32I, x, y, 0, GL_RED_INTEGER, GL_INT,
+                 nullptr);
+    glBindTexture(GL_TEXTURE_2D, previousKeyTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32I, x, y, 0, GL_RED_INTEGER, GL_INT,
+                 nullptr);
     glBindTexture(GL_TEXTURE_2D, 0);
   });
 
-  glm::dvec2 pan = {0, 0};
-  float zoom = 1.0f;
+  // fp64 runs at 1/16 to 1/64 the rate of fp32 on consumer GPUs, where
+  // float-floats beat doubles for the views floats don't resolve. which is
+  // faster is timed once, on a patch of boundary at a depth both resolve.
+  const bool fastDoubles = [&] {
+    const int size = 256;
+    const double spacing = 1e-9;
+    glm::vec2 offsets[16] = {};
+    auto transform =
+        glm::scale(glm::dmat4(1.0), glm::dvec3(spacing, spacing, 1));
+    transform =
+        glm::translate(transform, glm::dvec3(-size / 2.0, -size / 2.0, 0));
+    computeShader.use();
+    computeShader.setDMat4("transform", transform);
+    setUniform("center", -0.743643887037151, 0.13182590420533);
+    setUniform("centerLow", 0.0, 0.0);
+    computeShader.setInt("maxIterations", 2000);
+    setUniform("periodTolerance", spacing * spacing * 1e-6);
+    computeShader.setInt("samples", 1);
+    computeShader.setVec2("offsets", offsets[0], 16);
+    computeShader.setInt("stride", 1);
+    setUniform("regionOrigin", 0, 0);
+    setUniform("regionEnd", size, size);
+    glBindImageTexture(1, iterationTexture, 0, GL_FALSE, 0, GL_READ_WRITE,
+                       GL_RG32F);
+    glBindImageTexture(2, periodTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                       GL_R32I);
+    glBindImageTexture(3, keyTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32I);
+    double seconds[2] = {};
+    for (const Precision precision :
+         {Precision::float64, Precision::floatFloat}) {
+      computeShader.setInt("precisionTier", int(precision));
+      // the first dispatch pays for whatever the driver does lazily
+      for (int run = 0; run < 2; run++) {
+        glFinish();
+        const double start = glfwGetTime();
+        glDispatchCompute(size / 16, size / 16, 1);
+        glFinish();
+        seconds[precision == Precision::floatFloat] = glfwGetTime() - start;
+      }
+    }
+    return seconds[0] <= seconds[1];
+  }();
+
+  View view;
+  ReferenceOrbit referenceOrbit;
+  SeriesApproximation series;
+  BlaTable blaTable;
+  StorageBuffer orbitBuffer;
+  StorageBuffer blaBuffer;
+  StorageBuffer histogramBuffer;
   int samplesPerAxis = 2;
+  CpuRenderer cpuRenderer;
+  bool useCpu = false;
+  // Mariani-Silver, off by default: a uniform border is a guess that fails
+  // for detail thinner than a pixel.
+  bool subdivide = false;
+  // one sample per pixel first, the rest only where it finds edges
+  bool adaptive = false;
+  // progressive refinement: every 4th pixel, then every 2nd, then the rest
+  // on consecutive frames (and the adaptive refine pass after).
+  bool progressive = false;
+  // double-doubles wherever they still resolve pixels, as a reference for
+  // the cheaper precisions and perturbation. see precisionFor.
+  bool referencePrecision = false;
+  Coloring coloring = Coloring::linear;
+  // the transfer table needs to follow a change of the frame or coloring
+  bool recolor = true;
+  // passes of the frame on screen done so far, nothing is rendered once
+  // they all are until something below changes.
+  int pass = 0;
+  // the frame on screen started out as a reprojection of the one before,
+  // passes keep that where they'd paint coarse blocks.
+  bool preview = false;
+  // everything the frame depends on, it's only rendered again once one of
+  // these changes (or pass is reset, like reloading the shaders does).
+  struct Settings {
+    View view;
+    int maxIterations, width, height, samplesPerAxis;
+    bool useCpu, subdivide, adaptive, progressive, referencePrecision;
+
+    auto operator==(const Settings &) const -> bool = default;
+  };
+  const auto currentSettings = [&] {
+    return Settings{view,
+                    view.maxIterations(),
+                    int(window.resolution.x),
+                    int(window.resolution.y),
+                    samplesPerAxis,
+                    useCpu,
+                    subdivide,
+                    adaptive,
+                    progressive,
+                    referencePrecision};
+  };
+  Settings rendered{};
+  // finished tiles of past frames, see tile_cache.hpp. behind it the ones
+  // on disk, shared with other processes, when MANDELBROT_TILE_STORE names
+  // a file for them.
+  TileCache tileCache;
+  std::optional<TileStore> tileStore;
+  if (const char *path = std::getenv("MANDELBROT_TILE_STORE")) {
+    tileStore.emplace(path);
+  }
+  // what wrote the GPU's pixels, for their formula: kernelVersion for the
+  // shader this was built with, after reloading the shaders a hash of
+  // shader.comp as it is now, which could be anything.
+  uint32_t shaderKernel = kernelVersion;
+  const auto findTile = [&](const TileKey &key) -> std::optional<TileView> {
+    if (const CachedTile *tile = tileCache.find(key)) {
+      return tile->view();
+    }
+    if (tileStore) {
+      return tileStore->find(key);
+    }
+    return std::nullopt;
+  };
+  // a block of the frame the cache had a tile for: one captured from a
+  // finished frame, loaded as it is at origin, or else every tile of the
+  // level under it, see TileGrid::load.
+  struct Hit {
+    Region clip;
+    std::vector<TileView> tiles;
+    std::optional<glm::ivec2> origin;
+  };
+  // what of the frame on screen the cache didn't have, what every pass of
+  // it renders
+  std::vector<Region> pending;
+  // the middle of the frame on screen that a zoom out kept from the one
+  // before as a preview, what its passes go over instead of all of it
+  std::optional<Region> kept;
+  // where the tiles of the frame on screen start. shifts move it along so
+  // the tiles captured before still line up with the pixels.
+  glm::ivec2 gridOrigin{0};
+  // the pixels of the frame on screen resampled from level tiles rather
+  // than rendered, the tiles a finished frame passes on leave them out.
+  std::vector<uint8_t> approximate;
+  // the frame on screen is finished, in the history and its tiles in the
+  // cache
+  bool cached = true;
+  // on top of the tiles of finished frames, idle frames render tiles in
+  // the background, see prefetch.hpp: what's likely to come into view next,
+  // the next zoom steps and the ring around the frame, further out where
+  // panning heads.
+  bool prefetch = true;
+  Prefetcher prefetcher([] { glfwPostEmptyEvent(); });
+  // jobs since the view last changed, a cap in case their tiles don't
+  // stay in the cache.
+  int prefetchJobs = 0;
+  // the way the view moved last, what prefetching goes by
+  bool zooming = true;
+  float zoomFactor = 1.1f;
+  glm::ivec2 panDirection{0};
+  // views finished on screen before, left and right go back and forth
+  // through them. restoring is the entry to show next.
+  History history;
+  const HistoryEntry *restoring = nullptr;
+  // panning moves the view by whole pixels, see shift below. this is the
+  // fraction that didn't add up to one yet.
+  glm::dvec2 panRemainder{0.0};
 
   glEnable(GL_ALPHA_TEST);
   glAlphaFunc(GL_BLEND, 0.5f);
@@ -82,47 +344,798 @@ int main() {
       }
     }
 
+    for (auto &[key, tile] : prefetcher.collect()) {
+      if (tileStore) {
+        tileStore->insert(key, tile);
+      }
+      tileCache.insert(key, std::move(tile));
+    }
+
+    const Settings settings = currentSettings();
+    const int maxIterations = settings.maxIterations;
+    const double spacing = view.pixelSpacing(window.resolution.y).toDouble();
+
+    // screen space -> offset from the view centre, the centre itself is added
+    // in the shader (or reached through the reference orbit).
     auto transform = glm::dmat4(1.0);
-    // apply pan and zoom
-    transform = glm::translate(transform, glm::dvec3(pan, 0));
-    transform = glm::scale(transform, glm::dvec3(1 / zoom, 1 / zoom, 1));
-    // convert screen space to ndc
-    transform = glm::translate(transform, glm::dvec3(-1, -1, 0));
-    transform = glm::scale(transform, glm::dvec3(2, 2, 1) /
-                                          glm::dvec3(window.resolution, 1));
+    transform = glm::scale(transform, glm::dvec3(spacing, spacing, 1));
+    transform = glm::translate(
+        transform, glm::dvec3(-glm::dvec2(window.resolution) / 2.0, 0));
+
+    // the arithmetic shader.comp iterates in, see perturbation.hpp. fixed
+    // point takes a variant of it for the limbs the view needs, if that
+    // doesn't build it's perturbation. the CPU has its own, see
+    // cpuPrecision.
+    const int fixedLimbs = int(view.requiredLimbs(window.resolution.y)) + 1;
+    const ComputeVariant *fixedPointShader = nullptr;
+    const Precision precision = [&] {
+      if (useCpu) {
+        return cpuPrecision(spacing, fixedLimbs, referencePrecision);
+      }
+      const Precision wanted =
+          precisionFor(spacing, fastDoubles, referencePrecision);
+      if (wanted != Precision::fixedPoint) {
+        return wanted;
+      }
+      const ComputeVariant &variant =
+          fixedPointShaders
+              .try_emplace(fixedLimbs, "shader.comp",
+                           std::format("#define FIXED_LIMBS {}\n", fixedLimbs))
+              .first->second;
+      if (variant.id) {
+        fixedPointShader = &variant;
+        return wanted;
+      }
+      return Precision::perturbed;
+    }();
+    // orbits coming back within a thousandth of a pixel are taken as cycles,
+    // but not closer than doubles (or double-doubles) can tell points apart.
+    // shader.comp has its own floor for floats, fixed point has limbs to
+    // spare below the pixels.
+    const double periodTolerance = glm::pow(
+        glm::max(spacing * 1e-3,
+                 precision == Precision::fixedPoint     ? 0.0
+                 : precision == Precision::doubleDouble ? 1e-30
+                                                        : 1e-15),
+        2.0);
+
+    const bool perturb = precision == Precision::perturbed;
+    // distance from the centre to the furthest pixel
+    const double frameRadius =
+        spacing * glm::length(glm::dvec2(window.resolution) / 2.0 + 1.0);
+    // panning keeps the reference orbit until the view centre is a frame
+    // radius away from it, so the series and BLA reach twice as far.
+    const double seriesRadius = 2.0 * frameRadius;
+    std::complex<double> referenceOffset;
+    if (perturb) {
+      const bool recomputed =
+          referenceOrbit.update(view, maxIterations, FloatExp(frameRadius));
+      if (recomputed) {
+        orbitBuffer.upload(referenceOrbit.points.data(),
+                           referenceOrbit.points.size() *
+                               sizeof(referenceOrbit.points[0]));
+      }
+      if (recomputed || series.radius != seriesRadius) {
+        series.compute(referenceOrbit, seriesRadius, spacing);
+        blaTable.compute(referenceOrbit, seriesRadius);
+        blaBuffer.upload(blaTable.steps.data(),
+                         blaTable.steps.size() * sizeof(blaTable.steps[0]));
+      }
+      referenceOffset = referenceOrbit.offset(view);
+    }
+
+    const bool adaptivePasses = adaptive && samples > 1;
+    const int width = int(window.resolution.x);
+    const int height = int(window.resolution.y);
+    const int passCount = progressive ? 3 + adaptivePasses : 1;
+    // what changes the pixels besides the view and maxIterations, for the
+    // history and tile cache: the settings, the precision they were iterated
+    // in (see PrefetchJob::key), and in the top half the kernel that wrote
+    // them. z^2 + c is the only formula there is.
+    const auto formulaFor = [&](uint32_t kernel) {
+      return uint64_t(samplesPerAxis) | uint64_t(adaptive) << 8 |
+             uint64_t(subdivide) << 9 | uint64_t(referencePrecision) << 10 |
+             uint64_t(kernel) << 32;
+    };
+    const uint64_t formula =
+        formulaFor(useCpu ? kernelVersion : shaderKernel) |
+        uint64_t(precision) << 11;
+    // the tiles of the level under the frame, what it looks up and
+    // prefetching starts from. they come from the CPU kernels.
+    const PrefetchJob here{TileGrid::of(view, width, height),
+                           maxIterations,
+                           formulaFor(kernelVersion),
+                           samplesPerAxis,
+                           subdivide,
+                           adaptive,
+                           referencePrecision,
+                           {}};
+
+    // a resized frame has nothing that came from before
+    if (approximate.size() != size_t(width) * height) {
+      approximate.assign(size_t(width) * height, 1);
+    }
+
+    // a finished frame that only moved by whole pixels is shifted instead of
+    // redrawn, just the strips that came into view get rendered. zooming out
+    // of one keeps it resampled into the middle as a preview, the border
+    // around it gets rendered right away and the passes replace the middle
+    // after. any other change of just the view is resampled from what's on
+    // screen as a preview for the passes to replace.
+    glm::ivec2 shift{0};
+    bool keep = false;
+    bool reproject = false;
+    // the snapshot of a view gone back or forward to, in place of a render.
+    // it's the finished frame unless what else the pixels depend on changed
+    // since, then it's the preview the passes refine.
+    const HistoryEntry *restored = nullptr;
+    if (restoring && restoring->view == view &&
+        restoring->snapshot.width == width &&
+        restoring->snapshot.height == height) {
+      restored = restoring;
+      const bool current = restored->maxIterations == maxIterations &&
+                           restored->formula == formula;
+      preview = !current;
+      pass = current ? passCount : 0;
+      kept.reset();
+      gridOrigin = glm::ivec2(0);
+      std::fill(approximate.begin(), approximate.end(), uint8_t(1));
+      rendered = settings;
+    }
+    restoring = nullptr;
+    // previous pixels per pixel, and the move in previous pixels
+    double reprojectScale = 1.0;
+    glm::dvec2 reprojectOffset{0.0};
+    if (!(settings == rendered)) {
+      // whatever the prefetcher is at was planned for the frame before,
+      // and the cores are needed for this one
+      prefetcher.cancel();
+      kept.reset();
+      Settings moved = settings;
+      moved.view.centerX = rendered.view.centerX;
+      moved.view.centerY = rendered.view.centerY;
+      Settings zoomed = settings;
+      zoomed.view = rendered.view;
+      zoomed.maxIterations = rendered.maxIterations;
+      const FloatExp pixel = rendered.view.pixelSpacing(height);
+      reprojectScale = (view.radius / rendered.view.radius).toDouble();
+      reprojectOffset = glm::dvec2(
+          ((view.centerX - rendered.view.centerX).toFloatExp() / pixel)
+              .toDouble(),
+          ((view.centerY - rendered.view.centerY).toFloatExp() / pixel)
+              .toDouble());
+      const glm::dvec2 whole = glm::round(reprojectOffset);
+      if (pass >= passCount && moved == rendered &&
+          glm::all(glm::lessThan(glm::abs(whole), glm::dvec2(width, height))) &&
+          glm::all(glm::lessThan(glm::abs(reprojectOffset - whole),
+                                 glm::dvec2(1e-3)))) {
+        shift = glm::ivec2(whole);
+        const int size = CachedTile::size;
+        gridOrigin = ((gridOrigin - shift) % size + size) % size;
+      } else if (pass >= passCount && zoomed == rendered &&
+                 reprojectScale > 1.0 && reprojectScale < 16.0) {
+        keep = true;
+        preview = false;
+      } else {
+        // past 16x the preview is mostly a blur or mostly empty
+        reproject = zoomed == rendered && (pass > 0 || preview) &&
+                    reprojectScale > 1.0 / 16.0 && reprojectScale < 16.0;
+        preview = reproject;
+        pass = 0;
+      }
+      if (shift == glm::ivec2(0)) {
+        gridOrigin = glm::ivec2(0);
+      }
+      rendered = settings;
+    }
+
+    // what this frame renders: the first pass at some stride over some
+    // regions of the frame, then the adaptive refine pass over them.
+    std::vector<Region> regions;
+    // tiles the cache had for some of that, loaded in its place
+    std::vector<Hit> hits;
+    int stride = 1;
+    bool skipCoarse = false;
+    bool firstPass = true;
+    bool refinePass = adaptivePasses;
+    // clip of approximate, see there
+    const auto mark = [&](const Region &clip, bool resampled) {
+      for (int y = clip.y0; y < clip.y1; y++) {
+        std::fill_n(&approximate[size_t(y) * width + clip.x0],
+                    clip.x1 - clip.x0, uint8_t(resampled));
+      }
+    };
+    // a hit if the cache has the tile of a finished frame at (x0, y0), or
+    // every tile of the level under it clip takes samples from
+    const auto lookUp = [&](int x0, int y0, const Region &clip) {
+      if (const auto tile = findTile(TileKey::at(view, width, height, x0, y0,
+                                                 maxIterations, formula))) {
+        hits.push_back({clip, {*tile}, glm::ivec2(x0, y0)});
+        mark(clip, false);
+        return true;
+      }
+      const Region range = here.grid.tiles(clip);
+      Hit hit{clip, {}, std::nullopt};
+      for (int j = range.y0; j < range.y1; j++) {
+        for (int i = range.x0; i < range.x1; i++) {
+          const auto tile = findTile(here.key(i, j));
+          if (!tile) {
+            return false;
+          }
+          hit.tiles.push_back(*tile);
+        }
+      }
+      hits.push_back(std::move(hit));
+      mark(clip, true);
+      return true;
+    };
+    const auto loadHit = [&](const FrameBuffers &buffers, const Hit &hit) {
+      if (hit.origin) {
+        hit.tiles[0].load(buffers, hit.origin->x, hit.origin->y, hit.clip);
+      } else {
+        here.grid.load(buffers, hit.clip, hit.tiles);
+      }
+    };
+    // the blocks of the frame, tile sized and on the grid from gridOrigin,
+    // that strips of it cut through and the cache doesn't have, as regions
+    // merged across rows where they line up. the ones it has are loaded.
+    const auto missedBlocks = [&](const std::vector<Region> &strips) {
+      const int size = CachedTile::size;
+      const auto tileStart = [&](int p, int origin) {
+        return p - ((p - origin) % size + size) % size;
+      };
+      std::vector<Region> missed;
+      for (const Region &strip : strips) {
+        for (int y0 = tileStart(strip.y0, gridOrigin.y); y0 < strip.y1;
+             y0 += size) {
+          for (int x0 = tileStart(strip.x0, gridOrigin.x); x0 < strip.x1;
+               x0 += size) {
+            const Region clip{std::max(x0, strip.x0), std::max(y0, strip.y0),
+                              std::min(x0 + size, strip.x1),
+                              std::min(y0 + size, strip.y1)};
+            if (!lookUp(x0, y0, clip)) {
+              missed.push_back(clip);
+              mark(clip, false);
+            }
+          }
+        }
+      }
+      std::sort(missed.begin(), missed.end(),
+                [](const Region &a, const Region &b) {
+                  return std::pair(a.y0, a.x0) < std::pair(b.y0, b.x0);
+                });
+      return mergeRegions(missed);
+    };
+    if (shift != glm::ivec2(0)) {
+      // what was resampled moves along with the pixels
+      std::vector<uint8_t> moved(approximate.size(), 1);
+      for (int y = std::max(0, -shift.y);
+           y < std::min(height, height - shift.y); y++) {
+        for (int x = std::max(0, -shift.x);
+             x < std::min(width, width - shift.x); x++) {
+          moved[size_t(y) * width + x] =
+              approximate[size_t(y + shift.y) * width + x + shift.x];
+        }
+      }
+      approximate = std::move(moved);
+      // the uncovered columns, then the uncovered rows next to them
+      std::vector<Region> uncovered;
+      const int x0 = shift.x > 0 ? width - shift.x : 0;
+      const int x1 = shift.x > 0 ? width : -shift.x;
+      if (x0 != x1) {
+        uncovered.push_back({x0, 0, x1, height});
+      }
+      const int y0 = shift.y > 0 ? height - shift.y : 0;
+      const int y1 = shift.y > 0 ? height : -shift.y;
+      if (y0 != y1) {
+        uncovered.push_back({shift.x < 0 ? x1 : 0, y0,
+                             shift.x > 0 ? x0 : width, y1});
+      }
+      regions = missedBlocks(uncovered);
+    } else if (keep) {
+      // the pixels the frame before covers whole, along each axis. the
+      // ones next to the border are rendered too, the resample may round
+      // them either way.
+      const auto covered = [&](int size, double offset) {
+        int first = size;
+        int last = 0;
+        for (int p = 0; p < size; p++) {
+          const double low =
+              (p - size / 2.0) * reprojectScale + size / 2.0 + offset;
+          if (low >= 0.0 && low + reprojectScale <= size) {
+            first = std::min(first, p);
+            last = p + 1;
+          }
+        }
+        return std::pair(first + 1, last - 1);
+      };
+      const auto [x0, x1] = covered(width, reprojectOffset.x);
+      const auto [y0, y1] = covered(height, reprojectOffset.y);
+      std::vector<Region> border;
+      if (x0 >= x1 || y0 >= y1) {
+        border.push_back({0, 0, width, height});
+      } else {
+        border.push_back({0, 0, width, y0});
+        border.push_back({0, y0, x0, y1});
+        border.push_back({x1, y0, width, y1});
+        border.push_back({0, y1, width, height});
+        // resampling again and again would smear it, the passes replace it
+        kept = Region{x0, y0, x1, y1};
+        preview = true;
+        pass = 0;
+      }
+      std::erase_if(border, [](const Region &strip) {
+        return strip.x0 >= strip.x1 || strip.y0 >= strip.y1;
+      });
+      regions = missedBlocks(border);
+    } else if (reproject && !progressive) {
+      // a full render would hold the preview back until it's done, so it
+      // waits for a frame the view stays put.
+    } else if (pass < passCount) {
+      if (pass == 0) {
+        // the passes go over the blocks the cache doesn't have
+        pending = missedBlocks({kept.value_or(Region{0, 0, width, height})});
+        kept.reset();
+      }
+      regions = pending;
+      if (progressive) {
+        firstPass = pass < 3;
+        refinePass = pass == 3;
+        if (firstPass) {
+          stride = 4 >> pass;
+          skipCoarse = pass > 0;
+        }
+      }
+      pass++;
+    }
+
+    const bool changed =
+        !regions.empty() || keep || reproject || !hits.empty() || restored;
+    cached = cached && !changed;
+    recolor = recolor || changed;
 
     // render
     {
-      computeShader.use();
-      computeShader.setVec2("resolution", window.resolution);
-      computeShader.setVec2("offsets", offsets[0], 16);
-      computeShader.setDMat4("transform", transform);
-      computeShader.setInt("maxIterations", 100 * (glm::log(zoom) + 1));
-      computeShader.setInt("samples", samples);
-
-      glBindImageTexture(1, framebufferTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY,
-                         GL_RGBA32F);
-      glDispatchCompute((window.resolution.x + 15) / 16, (window.resolution.y + 15) / 16, 1);
-      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+      if (!changed) {
+        // finished, the framebuffer still holds it
+      } else if (useCpu) {
+        Frame frame;
+        frame.width = window.resolution.x;
+        frame.height = window.resolution.y;
+        frame.spacing = spacing;
+        frame.center = {view.centerX.toDouble(), view.centerY.toDouble()};
+        frame.perturb = perturb;
+        frame.doubleDouble = precision == Precision::doubleDouble;
+        frame.centerLow = {view.centerX.lowDouble(), view.centerY.lowDouble()};
+        frame.fixedPoint = precision == Precision::fixedPoint;
+        if (frame.fixedPoint) {
+          frame.fixedCenterX = view.centerX.twosComplement(fixedLimbs - 1);
+          frame.fixedCenterY = view.centerY.twosComplement(fixedLimbs - 1);
+        }
+        frame.orbit = &referenceOrbit;
+        frame.referenceOffset = referenceOffset;
+        frame.series = &series;
+        frame.bla = &blaTable;
+        frame.maxIterations = maxIterations;
+        frame.periodTolerance = periodTolerance;
+        frame.samples = samples;
+        frame.offsets = &offsets[0].x;
+        frame.subdivide = subdivide;
+        frame.adaptive = adaptive;
+        frame.stride = stride;
+        frame.skipCoarse = skipCoarse;
+        frame.keepPreview = preview;
+        if (shift != glm::ivec2(0)) {
+          cpuRenderer.shift(shift.x, shift.y);
+        }
+        if (keep || reproject) {
+          cpuRenderer.reproject(reprojectScale, reprojectOffset.x,
+                                reprojectOffset.y, keep, maxIterations);
+        }
+        if (restored) {
+          const FrameBuffers buffers = cpuRenderer.frameBuffers(width, height);
+          restored->snapshot.restore(buffers);
+          if (preview) {
+            std::fill_n(buffers.keys, size_t(width) * height,
+                        CpuRenderer::previewKey);
+          }
+        }
+        if (!hits.empty()) {
+          const FrameBuffers buffers = cpuRenderer.frameBuffers(width, height);
+          for (const Hit &hit : hits) {
+            loadHit(buffers, hit);
+          }
+        }
+        // all regions need their first samples before any is refined
+        for (const Region &region : regions) {
+          frame.x0 = region.x0;
+          frame.y0 = region.y0;
+          frame.x1 = region.x1;
+          frame.y1 = region.y1;
+          if (firstPass) {
+            cpuRenderer.render(frame);
+          }
+        }
+        for (const Region &region : regions) {
+          frame.x0 = region.x0;
+          frame.y0 = region.y0;
+          frame.x1 = region.x1;
+          frame.y1 = region.y1;
+          if (refinePass) {
+            cpuRenderer.refine(frame);
+          }
+        }
+
+        glBindTexture(GL_TEXTURE_2D, iterationTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame.width, frame.height,
+                        GL_RG, GL_FLOAT, cpuRenderer.pixels.data());
+        glBindTexture(GL_TEXTURE_2D, periodTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame.width, frame.height,
+                        GL_RED_INTEGER, GL_INT, cpuRenderer.periods.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+      } else {
+        // uniforms go to whichever of the two is bound
+        computeShader.use();
+        if (fixedPointShader) {
+          fixedPointShader->use();
+          const size_t fraction = fixedLimbs - 1;
+          setUniform("fixedCenterX",
+                     view.centerX.twosComplement(fraction).data(), fixedLimbs);
+          setUniform("fixedCenterY",
+                     view.centerY.twosComplement(fraction).data(), fixedLimbs);
+        }
+        setUniform("resolution", window.resolution);
+        setUniform("offsets", &offsets[0], 16);
+        setUniform("transform", transform);
+        setUniform("center", view.centerX.toDouble(), view.centerY.toDouble());
+        setUniform("centerLow", view.centerX.lowDouble(),
+                   view.centerY.lowDouble());
+        setUniform("precisionTier", int(precision));
+        setUniform("orbitLength", int(referenceOrbit.points.size()));
+        setUniform("referenceOffset", referenceOffset.real(),
+                   referenceOffset.imag());
+        setUniform("skipIterations", series.skipIterations);
+        setUniform("seriesRadius", series.radius);
+        setUniform("seriesA", series.a.real(), series.a.imag());
+        setUniform("seriesB", series.b.real(), series.b.imag());
+        setUniform("seriesC", series.c.real(), series.c.imag());
+        setUniform("blaLevels",
+                   std::min(32, int(blaTable.levelOffsets.size())));
+        setUniform("blaLevelOffsets", blaTable.levelOffsets.data(),
+                   std::min(32, int(blaTable.levelOffsets.size())));
+        setUniform("maxIterations", maxIterations);
+        setUniform("periodTolerance", periodTolerance);
+        setUniform("samples", samples);
+        setUniform("subdivide", subdivide);
+        setUniform("adaptive", adaptivePasses);
+        setUniform("pixelSpacing", spacing);
+
+        // the refine pass reads back the first samples
+        glBindImageTexture(1, iterationTexture, 0, GL_FALSE, 0, GL_READ_WRITE,
+                           GL_RG32F);
+        glBindImageTexture(2, periodTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                           GL_R32I);
+        glBindImageTexture(3, keyTexture, 0, GL_FALSE, 0, GL_READ_WRITE,
+                           GL_R32I);
+        orbitBuffer.bind(2);
+        blaBuffer.bind(3);
+        if (shift != glm::ivec2(0)) {
+          shiftTexture(iterationTexture, previousTexture, width, height,
+                       shift.x, shift.y);
+          shiftTexture(periodTexture, previousPeriodTexture, width, height,
+                       shift.x, shift.y);
+          shiftTexture(keyTexture, previousKeyTexture, width, height, shift.x,
+                       shift.y);
+        }
+        if (keep || reproject) {
+          glCopyImageSubData(iterationTexture, GL_TEXTURE_2D, 0, 0, 0, 0,
+                             previousTexture, GL_TEXTURE_2D, 0, 0, 0, 0, width,
+                             height, 1);
+          glCopyImageSubData(periodTexture, GL_TEXTURE_2D, 0, 0, 0, 0,
+                             previousPeriodTexture, GL_TEXTURE_2D, 0, 0, 0, 0,
+                             width, height, 1);
+          glCopyImageSubData(keyTexture, GL_TEXTURE_2D, 0, 0, 0, 0,
+                             previousKeyTexture, GL_TEXTURE_2D, 0, 0, 0, 0,
+                             width, height, 1);
+          glBindImageTexture(4, previousTexture, 0, GL_FALSE, 0, GL_READ_ONLY,
+                             GL_RG32F);
+          glBindImageTexture(5, previousPeriodTexture, 0, GL_FALSE, 0,
+                             GL_READ_ONLY, GL_R32I);
+          glBindImageTexture(6, previousKeyTexture, 0, GL_FALSE, 0,
+                             GL_READ_ONLY, GL_R32I);
+          setUniform("reproject", true);
+          setUniform("reprojectKeep", keep);
+          setUniform("reprojectScale", reprojectScale);
+          setUniform("reprojectOffset", reprojectOffset.x, reprojectOffset.y);
+          glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+          glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+          setUniform("reproject", false);
+        }
+        if (restored) {
+          std::vector<float> values(size_t(width) * height * 2);
+          std::vector<int> periods(size_t(width) * height);
+          std::vector<int> keys(size_t(width) * height);
+          const FrameBuffers buffers{values.data(), periods.data(),
+                                     keys.data(), width};
+          restored->snapshot.restore(buffers);
+          if (preview) {
+            std::fill(keys.begin(), keys.end(), CpuRenderer::previewKey);
+          }
+          glTextureSubImage2D(iterationTexture, 0, 0, 0, width, height, GL_RG,
+                              GL_FLOAT, values.data());
+          glTextureSubImage2D(periodTexture, 0, 0, 0, width, height,
+                              GL_RED_INTEGER, GL_INT, periods.data());
+          glTextureSubImage2D(keyTexture, 0, 0, 0, width, height,
+                              GL_RED_INTEGER, GL_INT, keys.data());
+        }
+        if (!hits.empty()) {
+          // loaded on the CPU into a frame of its own, the hits are uploaded
+          // out of it
+          std::vector<float> values(size_t(width) * height * 2);
+          std::vector<int> periods(size_t(width) * height);
+          std::vector<int> keys(size_t(width) * height);
+          const FrameBuffers staging{values.data(), periods.data(),
+                                     keys.data(), width};
+          glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+          for (const Hit &hit : hits) {
+            loadHit(staging, hit);
+            const Region &clip = hit.clip;
+            const size_t first = size_t(clip.y0) * width + clip.x0;
+            const int w = clip.x1 - clip.x0;
+            const int h = clip.y1 - clip.y0;
+            glTextureSubImage2D(iterationTexture, 0, clip.x0, clip.y0, w, h,
+                                GL_RG, GL_FLOAT, &values[first * 2]);
+            glTextureSubImage2D(periodTexture, 0, clip.x0, clip.y0, w, h,
+                                GL_RED_INTEGER, GL_INT, &periods[first]);
+            glTextureSubImage2D(keyTexture, 0, clip.x0, clip.y0, w, h,
+                                GL_RED_INTEGER, GL_INT, &keys[first]);
+          }
+          glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        }
+        setUniform("keepPreview", preview);
+        setUniform("stride", stride);
+        setUniform("skipCoarse", skipCoarse);
+        for (int adaptivePass = 0; adaptivePass < 2; adaptivePass++) {
+          if (!(adaptivePass == 0 ? firstPass : refinePass)) {
+            continue;
+          }
+          setUniform("adaptivePass", adaptivePass);
+          for (const Region &region : regions) {
+            setUniform("regionOrigin", region.x0, region.y0);
+            setUniform("regionEnd", region.x1, region.y1);
+            // one invocation per pixel of the pass, see pass_pixel. refine
+            // goes over every pixel.
+            const bool coarse = adaptivePass == 0 && skipCoarse;
+            const int step = adaptivePass == 0 ? stride * (coarse ? 2 : 1) : 1;
+            glDispatchCompute(
+                ((region.x1 - region.x0 + step - 1) / step + 15) / 16,
+                ((region.y1 - region.y0 + step - 1) / step + 15) / 16,
+                coarse ? 3 : 1);
+          }
+          glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT |
+                          GL_TEXTURE_UPDATE_BARRIER_BIT);
+        }
+      }
+
+      // a finished frame goes into the history and its tiles into the cache
+      // once nothing changes anymore, so panning and zooming don't read it
+      // back on every frame.
+      if (!changed && pass >= passCount && !cached) {
+        std::vector<float> values;
+        std::vector<int> periods, keys;
+        FrameBuffers buffers;
+        if (useCpu) {
+          buffers = cpuRenderer.frameBuffers(width, height);
+        } else {
+          // synchronous, it waits for the passes and copies 16 bytes a
+          // pixel over the bus, some 30 MB at 1080p. that's a few
+          // milliseconds once per view that settled, while nothing is
+          // moving, rather than a pixel pack buffer and a fence to poll
+          // on every frame after.
+          values.resize(size_t(width) * height * 2);
+          periods.resize(size_t(width) * height);
+          keys.resize(size_t(width) * height);
+          glGetTextureImage(iterationTexture, 0, GL_RG, GL_FLOAT,
+                            values.size() * sizeof(values[0]), values.data());
+          glGetTextureImage(periodTexture, 0, GL_RED_INTEGER, GL_INT,
+                            periods.size() * sizeof(periods[0]),
+                            periods.data());
+          glGetTextureImage(keyTexture, 0, GL_RED_INTEGER, GL_INT,
+                            keys.size() * sizeof(keys[0]), keys.data());
+          buffers = {values.data(), periods.data(), keys.data(), width};
+        }
+        history.record({view, samplesPerAxis, maxIterations, formula,
+                        Snapshot::capture(buffers, height)});
+        // the whole tiles on the grid, but not what was resampled or is
+        // there already
+        const int size = CachedTile::size;
+        for (int y0 = gridOrigin.y; y0 + size <= height; y0 += size) {
+          for (int x0 = gridOrigin.x; x0 + size <= width; x0 += size) {
+            bool resampled = false;
+            for (int y = y0; y < y0 + size && !resampled; y++) {
+              const auto row = approximate.begin() + size_t(y) * width + x0;
+              resampled = std::find(row, row + size, 1) != row + size;
+            }
+            const TileKey key = TileKey::at(view, width, height, x0, y0,
+                                            maxIterations, formula);
+            if (resampled || findTile(key)) {
+              continue;
+            }
+            CachedTile tile =
+                CachedTile::capture(buffers, x0, y0, maxIterations, samples);
+            if (tileStore) {
+              tileStore->insert(key, tile);
+            }
+            tileCache.insert(key, std::move(tile));
+          }
+        }
+        cached = true;
+      }
+
+      // the histogram only needs the finished pixels of this frame, the
+      // transfer table made from it is tiny. on the GPU both stay there,
+      // reading the histogram back would wait for the frame to finish.
+      if (recolor) {
+        if (coloring == Coloring::linear || useCpu) {
+          std::vector<uint32_t> bins(histogramBins, 0);
+          if (coloring != Coloring::linear) {
+            bins = cpuRenderer.histogram(maxIterations, histogramBins);
+          }
+          const std::vector<float> table = transferTable(coloring, bins);
+          glBindTexture(GL_TEXTURE_1D, transferTexture);
+          glTexSubImage1D(GL_TEXTURE_1D, 0, 0, histogramBins, GL_RED,
+                          GL_FLOAT, table.data());
+          glBindTexture(GL_TEXTURE_1D, 0);
+        } else {
+          const std::vector<uint32_t> bins(histogramBins, 0);
+          histogramShader.use();
+          histogramShader.setInt("maxIterations", maxIterations);
+          histogramBuffer.upload(bins.data(), bins.size() * sizeof(bins[0]));
+          histogramBuffer.bind(4);
+          glBindImageTexture(1, iterationTexture, 0, GL_FALSE, 0, GL_READ_ONLY,
+                             GL_RG32F);
+          glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+          glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+          transferShader.use();
+          transferShader.setInt("coloring", int(coloring));
+          glBindImageTexture(1, transferTexture, 0, GL_FALSE, 0,
+                             GL_WRITE_ONLY, GL_R32F);
+          glDispatchCompute(1, 1, 1);
+          glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        }
+        recolor = false;
+      }
 
       static double lastFrameTime = 0;
       double thisFrameTime = glfwGetTime();
-      fullscreenQuad.draw(framebufferTexture, "outputTexture");
+      shader.use();
+      setUniform("maxIterations", float(maxIterations));
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_1D, paletteTexture);
+      shader.setInt("palette", 1);
+      glActiveTexture(GL_TEXTURE2);
+      glBindTexture(GL_TEXTURE_1D, transferTexture);
+      shader.setInt("transfer", 2);
+      glActiveTexture(GL_TEXTURE0);
+      fullscreenQuad.draw(iterationTexture, "outputTexture");
       fontRenderer.renderText(
           std::format("FPS: {:.1f}", 1 / (thisFrameTime - lastFrameTime)),
           {0, 0}, 1, glm::vec4(1));
       fontRenderer.renderText(
-          std::format("MS: {}", samples),
+          std::format("MS: {}{}{}{}{}{}", samples,
+                      useCpu ? std::format(" (cpu {})", escapeTimeIsa())
+                             : "",
+                      subdivide ? " (subdivided)" : "",
+                      adaptive ? " (adaptive)" : "",
+                      progressive ? std::format(" (progressive {}/{})",
+                                                std::min(pass, passCount),
+                                                passCount)
+                                  : "",
+                      coloring == Coloring::equalized    ? " (equalized)"
+                      : coloring == Coloring::percentile ? " (percentile)"
+                                                         : ""),
           {0, 48}, 1, glm::vec4(1));
+      fontRenderer.renderText(
+          std::format("ZOOM: 1e{:.1f}{}", view.zoomLog() / glm::log(10.0),
+                      perturb ? std::format(" (perturbed, skip {})",
+                                            series.skipIterations)
+                      : precision == Precision::fixedPoint
+                          ? std::format(" (fixed point, {} limbs)", fixedLimbs)
+                      : precision == Precision::doubleDouble
+                          ? " (double-double)"
+                      : useCpu || precision == Precision::float64 ? " (double)"
+                      : precision == Precision::float32 ? " (float)"
+                                                        : " (float-float)"),
+          {0, 96}, 1, glm::vec4(1));
+
+      // period of the cycle under the cursor, only read back when either
+      // moved.
+      {
+        const auto mouse = Input::getMousePos();
+        const int px = int(mouse.x);
+        const int py = int(window.resolution.y) - 1 - int(mouse.y);
+        static glm::ivec2 lastCursor{-1};
+        static int period = 0;
+        if (changed || lastCursor != glm::ivec2(px, py)) {
+          lastCursor = glm::ivec2(px, py);
+          period = 0;
+          if (px >= 0 && py >= 0 && px < int(window.resolution.x) &&
+              py < int(window.resolution.y)) {
+            glGetTextureSubImage(periodTexture, 0, px, py, 0, 1, 1, 1,
+                                 GL_RED_INTEGER, GL_INT, sizeof(period),
+                                 &period);
+          }
+        }
+        fontRenderer.renderText(
+            period ? std::format("PERIOD: {}", period) : "PERIOD: -",
+            {0, 144}, 1, glm::vec4(1));
+      }
       lastFrameTime = thisFrameTime;
-      glFinish();
+      // only frames that rendered something have anything to wait for
+      if (changed) {
+        glFinish();
+      }
 
       // take inputs
       {
         if (Input::isKeyDown(GLFW_KEY_R)) {
           Shader::hotReloadAll();
-          pan = {0, 0};
-          zoom = 1.0f;
+          fixedPointShaders.clear();
+          view = View{};
+          pass = 0;
+          preview = false;
+          // rendered by the shaders before. the store's tiles stay, the
+          // new kernel doesn't match them.
+          tileCache.clear();
+          std::ifstream source("shader.comp");
+          uint32_t hash = 0x811c9dc5u;
+          for (auto it = std::istreambuf_iterator<char>(source);
+               it != std::istreambuf_iterator<char>(); ++it) {
+            hash = (hash ^ uint8_t(*it)) * 0x01000193u;
+          }
+          // never the build's version, the file could be the same though
+          shaderKernel = hash == kernelVersion ? hash + 1 : hash;
+        }
+
+        if (Input::isKeyPressed(GLFW_KEY_C)) {
+          useCpu = !useCpu;
+        }
+
+        if (Input::isKeyPressed(GLFW_KEY_M)) {
+          subdivide = !subdivide;
+        }
+
+        if (Input::isKeyPressed(GLFW_KEY_A)) {
+          adaptive = !adaptive;
+        }
+
+        if (Input::isKeyPressed(GLFW_KEY_P)) {
+          progressive = !progressive;
+        }
+
+        if (Input::isKeyPressed(GLFW_KEY_F)) {
+          prefetch = !prefetch;
+        }
+
+        if (Input::isKeyPressed(GLFW_KEY_D)) {
+          referencePrecision = !referencePrecision;
+        }
+
+        if (Input::isKeyPressed(GLFW_KEY_H)) {
+          coloring = Coloring((int(coloring) + 1) % 3);
+          recolor = true;
+        }
+
+        if (Input::isKeyPressed(GLFW_KEY_LEFT) ||
+            Input::isKeyPressed(GLFW_KEY_RIGHT)) {
+          restoring = Input::isKeyPressed(GLFW_KEY_LEFT)
+                          ? history.back(view, samplesPerAxis)
+                          : history.forward();
+          if (restoring) {
+            view = restoring->view;
+            samplesPerAxis = restoring->samplesPerAxis;
+            panRemainder = glm::dvec2(0.0);
+          }
         }
 
         if (Input::isKeyPressed(GLFW_KEY_UP)) {
@@ -138,9 +1151,17 @@ int main() {
 
         if (Input::isButtonDown(GLFW_MOUSE_BUTTON_1)) {
           auto pos = Input::getMousePos();
-          auto delta = (lastMousePos - pos) * sensitivity / zoom;
-          pan.x += delta.x;
-          pan.y -= delta.y;
+          auto delta = (lastMousePos - pos) * sensitivity;
+          // radius is half the height in pixels
+          panRemainder +=
+              glm::dvec2(delta.x, -delta.y) * (window.resolution.y / 2.0);
+          const glm::dvec2 whole = glm::trunc(panRemainder);
+          panRemainder -= whole;
+          view.panPixels(whole.x, whole.y, window.resolution.y);
+          if (whole != glm::dvec2(0.0)) {
+            zooming = false;
+            panDirection = glm::ivec2(glm::sign(whole));
+          }
           lastMousePos = pos;
         } else {
           lastMousePos = Input::getMousePos();
@@ -149,11 +1170,103 @@ int main() {
         auto scrollDelta = Input::scrollDelta();
 
         if (scrollDelta.length() >= 0.1) {
-          zoom *= (1.0f + scrollDelta.y * 0.1f);
+          view.zoomBy(1.0f + scrollDelta.y * 0.1f, window.resolution.y);
+          if (scrollDelta.y != 0.0f) {
+            zooming = true;
+            zoomFactor = 1.0f + scrollDelta.y * 0.1f;
+          }
+        }
+      }
+
+      // the tiles of job that the pixels of area (of its frame) take
+      // samples from and that neither the cache nor the store has, row by
+      // row.
+      const auto missingTiles = [&](const PrefetchJob &job,
+                                    const Region &area) {
+        const int size = CachedTile::size;
+        std::vector<Region> tiles;
+        const Region range = job.grid.tiles(area);
+        for (int j = range.y0; j < range.y1; j++) {
+          for (int i = range.x0; i < range.x1; i++) {
+            if (!findTile(job.key(i, j))) {
+              tiles.push_back(
+                  {i * size, j * size, (i + 1) * size, (j + 1) * size});
+            }
+          }
+        }
+        return tiles;
+      };
+      // the next two zoom steps the way the last one went
+      const auto nextZoom = [&]() -> std::optional<PrefetchJob> {
+        View next = view;
+        for (int step = 0; step < 2 && zoomFactor != 1.0f; step++) {
+          next.zoomBy(zoomFactor, height);
+          PrefetchJob job = here;
+          job.grid = TileGrid::of(next, width, height);
+          job.maxIterations = next.maxIterations();
+          job.tiles = missingTiles(job, {0, 0, width, height});
+          if (!job.tiles.empty()) {
+            return job;
+          }
+        }
+        return std::nullopt;
+      };
+      // a block all around the frame, three on the sides panning heads to
+      const auto ring = [&]() -> std::optional<PrefetchJob> {
+        const int size = CachedTile::size;
+        PrefetchJob job = here;
+        job.tiles = missingTiles(
+            job, {-size * (panDirection.x < 0 ? 3 : 1),
+                  -size * (panDirection.y < 0 ? 3 : 1),
+                  width + size * (panDirection.x > 0 ? 3 : 1),
+                  height + size * (panDirection.y > 0 ? 3 : 1)});
+        if (job.tiles.empty()) {
+          return std::nullopt;
+        }
+        return job;
+      };
+      const auto planPrefetch = [&]() -> std::optional<PrefetchJob> {
+        if (zooming) {
+          if (auto job = nextZoom()) {
+            return job;
+          }
+          return ring();
+        }
+        if (auto job = ring()) {
+          return job;
+        }
+        return nextZoom();
+      };
+
+      if (changed) {
+        prefetchJobs = 0;
+      }
+      // a finished frame nothing above changed is the same on the next
+      // frame, sleep until there's input instead of drawing it again and
+      // again. the timeout keeps the overlay ticking.
+      if (!changed && !recolor && pass >= passCount &&
+          currentSettings() == rendered) {
+        if (prefetch && prefetchJobs < 4 && !prefetcher.busy()) {
+          if (auto job = planPrefetch()) {
+            prefetcher.submit(std::move(*job));
+            prefetchJobs++;
+          } else {
+            // nothing left, until the view changes
+            prefetchJobs = 4;
+          }
         }
+        // the prefetcher wakes this up once it's done
+        glfwWaitEventsTimeout(0.25);
       }
     }
   });
 
-  glDeleteTextures(1, &framebufferTexture);
+  glDeleteTextures(1, &iterationTexture);
+  glDeleteTextures(1, &paletteTexture);
+  glDeleteTextures(1, &transferTexture);
+  glDeleteTextures(1, &periodTexture);
+  glDeleteTextures(1, &keyTexture);
+  glDeleteTextures(1, &previousTexture);
+  glDeleteTextures(1, &previousPeriodTexture);
+  glDeleteTextures(1, &previousKeyTexture);
 }
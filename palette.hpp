@@ -0,0 +1,75 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mandelbrot {
+
+// Lookup table shader.frag colours iteration counts with, rgb triples for
+// size evenly spaced fractions of maxIterations from 0 to 1. Changing it
+// doesn't need anything rendered again.
+inline auto sinPalette(int size) -> std::vector<float> {
+  std::vector<float> rgb(size_t(size) * 3);
+  for (int i = 0; i < size; i++) {
+    const float t = float(i) / float(size - 1);
+    // fades out towards the set, which stays black
+    rgb[i * 3 + 0] = std::sin(3.0f + t * 6.28318f) * (1 - t);
+    rgb[i * 3 + 1] = std::sin(3.0f + t * 6.28318f + 2.09439f) * (1 - t);
+    rgb[i * 3 + 2] = std::sin(3.0f + t * 6.28318f + 4.18878f) * (1 - t);
+  }
+  return rgb;
+}
+
+// How iteration counts are spread over the palette. linear is count /
+// maxIterations, the others go by the histogram of the frame: equalized
+// gives every colour the same share of its pixels, percentile stretches
+// the range between the 1st and 99th percentile over the whole palette.
+enum class Coloring { linear, equalized, percentile };
+
+// histogram bin i counts the pixels with count / maxIterations in
+// [i, i + 1) / (histogramBins - 1), see histogram.comp.
+constexpr int histogramBins = 4096;
+
+// count / maxIterations -> palette position at the same histogramBins
+// points as the bins start at, shader.frag interpolates in between.
+// transfer.comp makes the same table on the GPU.
+inline auto transferTable(Coloring coloring, const std::vector<uint32_t> &bins)
+    -> std::vector<float> {
+  const int size = int(bins.size());
+  std::vector<float> table(size);
+  // prefix sums, what's below every bin
+  std::vector<uint64_t> below(size + 1, 0);
+  for (int i = 0; i < size; i++) {
+    below[i + 1] = below[i] + bins[i];
+  }
+  const uint64_t total = below[size];
+  for (int i = 0; i < size; i++) {
+    table[i] = float(i) / float(size - 1);
+  }
+  if (coloring == Coloring::linear || total == 0) {
+    return table;
+  }
+  if (coloring == Coloring::equalized) {
+    for (int i = 0; i < size; i++) {
+      table[i] = float(double(below[i]) / double(total));
+    }
+    return table;
+  }
+  // where the bin a fraction of the pixels falls in ends
+  const auto percentile = [&](double fraction) {
+    const auto end = std::upper_bound(below.begin() + 1, below.end(),
+                                      uint64_t(fraction * double(total)));
+    return float(std::min<ptrdiff_t>(end - below.begin(), size - 1));
+  };
+  // from the start of the 1% bin to the end of the 99% one
+  const float low = percentile(0.01) - 1.0f;
+  const float high = std::max(percentile(0.99), low + 1.0f);
+  for (int i = 0; i < size; i++) {
+    table[i] = std::clamp((float(i) - low) / (high - low), 0.0f, 1.0f);
+  }
+  return table;
+}
+
+} // namespace mandelbrot
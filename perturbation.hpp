@@ -0,0 +1,249 @@
+#pragma once
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include "bigfixed.hpp"
+#include "view.hpp"
+
+namespace mandelbrot {
+
+// Past this pixel spacing doubles turn into blocks, so pixels are iterated
+// as deltas against a high precision reference orbit instead. Both
+// renderers go through double-doubles first, see Precision.
+static constexpr double perturbationSpacing = 1e-12;
+
+// What shader.comp iterates a frame in, the cheapest arithmetic that still
+// resolves its pixels. Floats are a lot faster than doubles on most GPUs
+// (and in llvmpipe), double-doubles a lot slower. Float-floats cover the
+// same views as doubles, for GPUs whose doubles are slower still. Fixed
+// point with as many limbs as the view needs resolves any depth, at a cost
+// that only reference precision pays. The CPU renderer iterates both float
+// tiers in doubles.
+enum class Precision {
+  float32,
+  floatFloat,
+  float64,
+  doubleDouble,
+  fixedPoint,
+  perturbed
+};
+
+// floats down to about a hundred ulps of the plane's [-2, 2] per pixel, the
+// rounding iterating adds up eats most of them.
+static constexpr double floatSpacing = 1e-5;
+// double-doubles resolve far deeper, but cost more than perturbation with
+// its skipped iterations once the counts get high.
+static constexpr double doubleDoubleSpacing = 1e-20;
+// past this double-doubles turn into blocks as well, a few dozen of their
+// ulps per pixel are about what floats have at floatSpacing.
+static constexpr double deepestDoubleDoubleSpacing = 1e-30;
+
+// fastDoubles: the GPU iterates doubles faster than float-floats.
+// reference: double-doubles down to where they stop resolving pixels and
+// fixed point past that, never perturbation. the ground truth the cheaper
+// tiers and perturbation can be checked against.
+inline auto precisionFor(double spacing, bool fastDoubles, bool reference)
+    -> Precision {
+  if (reference) {
+    return spacing >= deepestDoubleDoubleSpacing ? Precision::doubleDouble
+                                                 : Precision::fixedPoint;
+  }
+  if (spacing >= floatSpacing) {
+    return Precision::float32;
+  }
+  if (spacing >= perturbationSpacing) {
+    return fastDoubles ? Precision::float64 : Precision::floatFloat;
+  }
+  return spacing >= doubleDoubleSpacing ? Precision::doubleDouble
+                                        : Precision::perturbed;
+}
+
+// z_n of a point near the view centre iterated in arbitrary precision and
+// rounded to doubles. Pixels then only iterate their delta to it:
+//   dz' = 2 Z dz + dz^2 + dc
+// which stays small enough for hardware floats at any depth. dc is the
+// pixel's offset from the view centre plus offset(view), so panning keeps
+// the orbit instead of computing it again.
+struct ReferenceOrbit {
+  std::vector<std::complex<double>> points;
+
+  // keeps the orbit while the view centre is within reach of its centre
+  // and the view needs no more iterations or limbs than it was computed
+  // with, otherwise computes it for the view centre. true if it did.
+  inline auto update(const View &view, int maxIterations, FloatExp reach)
+      -> bool {
+    if (maxIterations <= this->maxIterations &&
+        view.centerX.fractionLimbs() <= centerX.fractionLimbs() &&
+        !(distance(view) > reach)) {
+      return false;
+    }
+    this->maxIterations = maxIterations;
+    centerX = view.centerX;
+    centerY = view.centerY;
+    compute();
+    return true;
+  }
+
+  // the view centre less the orbit's, what every dc is offset by.
+  inline auto offset(const View &view) const -> std::complex<double> {
+    return {(view.centerX - centerX).toFloatExp().toDouble(),
+            (view.centerY - centerY).toFloatExp().toDouble()};
+  }
+
+private:
+  BigFixed centerX, centerY;
+  int maxIterations = -1;
+
+  inline auto distance(const View &view) const -> FloatExp {
+    const FloatExp dx = (view.centerX - centerX).toFloatExp();
+    const FloatExp dy = (view.centerY - centerY).toFloatExp();
+    return (dx * dx + dy * dy).sqrt();
+  }
+
+  inline auto compute() -> void {
+    points.clear();
+    points.reserve(maxIterations + 1);
+    BigFixed zx(0.0, centerX.fractionLimbs());
+    BigFixed zy(0.0, centerX.fractionLimbs());
+    points.push_back({0.0, 0.0});
+    for (int i = 0; i < maxIterations; i++) {
+      // three squarings instead of four multiplies.
+      const BigFixed xx = zx * zx;
+      const BigFixed yy = zy * zy;
+      const BigFixed sum = zx + zy;
+      zy = sum * sum - xx - yy + centerY;
+      zx = xx - yy + centerX;
+      const std::complex<double> z{zx.toDouble(), zy.toDouble()};
+      points.push_back(z);
+      // the escaping point is kept, pixels that outlive the reference rebase
+      // back onto its start.
+      if (std::norm(z) > 4.0) {
+        break;
+      }
+    }
+  }
+};
+
+// Truncated power series of the pixel delta in dc along the reference:
+//   dz_n ~= A_n dc + B_n dc^2 + C_n dc^3
+// evaluated once per pixel to start iterating at n instead of 0.
+// The coefficients are kept pre-scaled by the frame radius r (a = A r,
+// b = B r^2, c = C r^3) so they stay in double range at any depth, pixels
+// then evaluate them at u = dc / r with |u| <= 1.
+struct SeriesApproximation {
+  std::complex<double> a, b, c;
+  double radius = 0.0;
+  int skipIterations = 0;
+
+  // largest truncation error allowed, relative to the spacing of adjacent
+  // pixels after the skipped iterations.
+  static constexpr double tolerance = 1e-3;
+
+  // radius: largest |dc| in the frame, spacing: pixel spacing.
+  inline auto compute(const ReferenceOrbit &orbit, double radius,
+                      double spacing) -> void {
+    this->radius = radius;
+    a = b = c = 0.0;
+    skipIterations = 0;
+
+    std::complex<double> an = 0.0, bn = 0.0, cn = 0.0, dn = 0.0;
+    const auto &Z = orbit.points;
+    // stop short of the end of the reference, the loop in the shader still
+    // needs a point to rebase from.
+    for (int n = 0; n + 2 < int(Z.size()); n++) {
+      const std::complex<double> z2 = 2.0 * Z[n];
+      const std::complex<double> nextA = z2 * an + radius;
+      const std::complex<double> nextB = z2 * bn + an * an;
+      const std::complex<double> nextC = z2 * cn + 2.0 * an * bn;
+      // the first dropped term, standing in for the truncation error.
+      const std::complex<double> nextD = z2 * dn + 2.0 * an * cn + bn * bn;
+      an = nextA, bn = nextB, cn = nextC, dn = nextD;
+
+      const double pixelDistance = std::abs(an) * spacing / radius;
+      const double deltaBound = std::abs(an) + std::abs(bn) + std::abs(cn);
+      // deltas no longer tiny next to the orbit may escape or need a rebase
+      // the series can't see.
+      if (std::abs(dn) > tolerance * pixelDistance || deltaBound > 1e-3 ||
+          !std::isfinite(deltaBound)) {
+        break;
+      }
+      a = an, b = bn, c = cn;
+      skipIterations = n + 1;
+    }
+  }
+};
+
+// Bivariate linear approximation: while the pixel delta is small next to the
+// reference, l iterations collapse into one linear step
+//   dz_{m+l} = A dz_m + B dc
+// The table holds a binary hierarchy of these steps, level k covering 2^k
+// iterations starting at m = 1 + j 2^k, each with the largest |dz| it's valid
+// for. Pixels take the longest valid step at any point of the orbit.
+struct BlaTable {
+  // std430 layout of the Bla struct in shader.comp.
+  struct Step {
+    std::complex<double> a, b;
+    double radius;
+    int32_t iterations;
+    int32_t padding;
+  };
+  static_assert(sizeof(Step) == 48);
+
+  std::vector<Step> steps;
+  // index into steps where each level starts.
+  std::vector<int32_t> levelOffsets;
+  double frameRadius = 0.0;
+
+  // relative size of the dropped dz^2 term a step may have, about the
+  // precision of a float.
+  static constexpr double epsilon = 0x1p-24;
+
+  // frameRadius: largest |dc| in the frame.
+  inline auto compute(const ReferenceOrbit &orbit, double frameRadius)
+      -> void {
+    this->frameRadius = frameRadius;
+    steps.clear();
+    levelOffsets.clear();
+
+    const auto &Z = orbit.points;
+    // single iterations m -> m + 1 for m in [1, size - 2], Z_0 = 0 would give
+    // a zero radius anyway.
+    const int count = int(Z.size()) - 2;
+    if (count <= 0) {
+      return;
+    }
+    levelOffsets.push_back(0);
+    for (int m = 1; m <= count; m++) {
+      steps.push_back(
+          {2.0 * Z[m], 1.0, epsilon * std::abs(Z[m]), 1, {}});
+    }
+
+    int previous = 0;
+    int levelSize = count;
+    while (levelSize > 1) {
+      levelOffsets.push_back(int32_t(steps.size()));
+      for (int j = 0; j < levelSize; j += 2) {
+        const Step x = steps[previous + j];
+        if (j + 1 == levelSize) {
+          steps.push_back(x);
+          continue;
+        }
+        const Step y = steps[previous + j + 1];
+        const double ax = std::abs(x.a);
+        const double reach =
+            std::max(0.0, (y.radius - std::abs(x.b) * frameRadius) / ax);
+        Step merged{y.a * x.a, y.a * x.b + y.b,
+                    std::min(x.radius, std::isfinite(reach) ? reach : 0.0),
+                    x.iterations + y.iterations,
+                    {}};
+        steps.push_back(merged);
+      }
+      previous = levelOffsets.back();
+      levelSize = (levelSize + 1) / 2;
+    }
+  }
+};
+
+} // namespace mandelbrot
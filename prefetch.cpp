@@ -0,0 +1,228 @@
+#include "prefetch.hpp"
+#include "simd_kernel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mandelbrot {
+
+auto PrefetchJob::precision() const -> Precision {
+  return cpuPrecision(std::ldexp(1.0, int(grid.level)),
+                      int(TileGrid::limbs(grid.level)) + 1,
+                      referencePrecision);
+}
+
+auto PrefetchJob::key(int i, int j) const -> TileKey {
+  return grid.key(i, j, maxIterations, formula | uint64_t(precision()) << 11);
+}
+
+Prefetcher::Prefetcher(std::function<void()> finished)
+    : finished(std::move(finished)), thread([this] { work(); }) {}
+
+Prefetcher::~Prefetcher() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  thread.join();
+}
+
+auto Prefetcher::busy() -> bool {
+  std::lock_guard lock(mutex);
+  return queued || working || !done.empty();
+}
+
+auto Prefetcher::submit(PrefetchJob job) -> bool {
+  {
+    std::lock_guard lock(mutex);
+    if (queued || working || !done.empty()) {
+      return false;
+    }
+    queued = std::move(job);
+  }
+  wake.notify_all();
+  return true;
+}
+
+auto Prefetcher::collect() -> std::vector<std::pair<TileKey, CachedTile>> {
+  std::lock_guard lock(mutex);
+  return std::exchange(done, {});
+}
+
+auto Prefetcher::cancel() -> void {
+  std::lock_guard lock(mutex);
+  queued.reset();
+  if (working) {
+    cancelled = true;
+  }
+}
+
+auto Prefetcher::work() -> void {
+  // the renderer's workers yield to everything else, this thread helps
+  // them out
+  ThreadPool::yieldToOthers();
+  while (true) {
+    PrefetchJob job;
+    {
+      std::unique_lock lock(mutex);
+      wake.wait(lock, [&] { return stopping || queued; });
+      if (stopping) {
+        return;
+      }
+      job = std::move(*queued);
+      queued.reset();
+      working = true;
+      cancelled = false;
+    }
+    auto tiles = render(job);
+    {
+      std::lock_guard lock(mutex);
+      done = std::move(tiles);
+      working = false;
+    }
+    if (finished) {
+      finished();
+    }
+  }
+}
+
+auto Prefetcher::render(const PrefetchJob &job)
+    -> std::vector<std::pair<TileKey, CachedTile>> {
+  if (job.tiles.empty()) {
+    return {};
+  }
+  const int size = CachedTile::size;
+  const FloatExp step = FloatExp(1.0).ldexp(job.grid.level);
+  const double spacing = step.toDouble();
+  const size_t limbs = TileGrid::limbs(job.grid.level);
+  const Precision precision = job.precision();
+  // the view of a frame over pixels of the level, what they're rendered
+  // in. its pixels are the level's, the centre is on their lattice.
+  const auto viewOf = [&](const Region &area) {
+    View view;
+    view.centerX = job.grid.x + BigFixed::fromFloatExp(
+                                    step * FloatExp((area.x0 + area.x1) / 2.0),
+                                    limbs);
+    view.centerY = job.grid.y + BigFixed::fromFloatExp(
+                                    step * FloatExp((area.y0 + area.y1) / 2.0),
+                                    limbs);
+    view.radius = step * FloatExp((area.y1 - area.y0) / 2.0);
+    return view;
+  };
+  Region bounds = job.tiles[0];
+  for (const Region &tile : job.tiles) {
+    bounds = {std::min(bounds.x0, tile.x0), std::min(bounds.y0, tile.y0),
+              std::max(bounds.x1, tile.x1), std::max(bounds.y1, tile.y1)};
+  }
+  std::vector<Region> jobTiles = job.tiles;
+  if (precision == Precision::perturbed) {
+    // one reference orbit, series and BLA for the whole job, set up like
+    // main.cpp does for a frame over all of its tiles. tiles further from
+    // the orbit than they reach would need one of their own.
+    const View reference = viewOf(bounds);
+    const double frameRadius =
+        spacing * std::hypot((bounds.x1 - bounds.x0) / 2.0 + 1.0,
+                             (bounds.y1 - bounds.y0) / 2.0 + 1.0);
+    const double seriesRadius = 2.0 * frameRadius;
+    if (orbit.update(reference, job.maxIterations, FloatExp(frameRadius)) ||
+        series.radius != seriesRadius) {
+      series.compute(orbit, seriesRadius, spacing);
+      bla.compute(orbit, seriesRadius);
+    }
+    const double offset = std::abs(orbit.offset(reference));
+    const double centerX = (bounds.x0 + bounds.x1) / 2.0;
+    const double centerY = (bounds.y0 + bounds.y1) / 2.0;
+    std::erase_if(jobTiles, [&](const Region &tile) {
+      const double x = std::max(std::abs(tile.x0 - centerX),
+                                std::abs(tile.x1 - centerX));
+      const double y = std::max(std::abs(tile.y0 - centerY),
+                                std::abs(tile.y1 - centerY));
+      return offset + spacing * std::hypot(x + 1.0, y + 1.0) > seriesRadius;
+    });
+  }
+
+  // each band of up to 8 rows of tiles is a frame of its own, which keeps
+  // the buffers small when a job covers a whole frame at up to twice its
+  // resolution. the tiles start it, so they're on the grid CpuRenderer
+  // cuts frames into.
+  std::vector<Region> bands;
+  for (const Region &region : mergeRegions(jobTiles)) {
+    for (int y0 = region.y0; y0 < region.y1; y0 += 8 * size) {
+      bands.push_back(
+          {region.x0, y0, region.x1, std::min(region.y1, y0 + 8 * size)});
+    }
+  }
+
+  // the same frame setup main.cpp does for the CPU renderer
+  const int fixedLimbs = int(limbs) + 1;
+  const int samples = job.samplesPerAxis * job.samplesPerAxis;
+  std::vector<float> offsets;
+  for (int i = 0; i < job.samplesPerAxis; i++) {
+    for (int j = 0; j < job.samplesPerAxis; j++) {
+      offsets.push_back(float(i) / float(job.samplesPerAxis));
+      offsets.push_back(float(j) / float(job.samplesPerAxis));
+    }
+  }
+  Frame frame;
+  frame.spacing = spacing;
+  frame.perturb = precision == Precision::perturbed;
+  frame.doubleDouble = precision == Precision::doubleDouble;
+  frame.fixedPoint = precision == Precision::fixedPoint;
+  frame.orbit = &orbit;
+  frame.series = &series;
+  frame.bla = &bla;
+  frame.maxIterations = job.maxIterations;
+  frame.periodTolerance = std::pow(
+      std::max(spacing * 1e-3,
+               precision == Precision::fixedPoint     ? 0.0
+               : precision == Precision::doubleDouble ? 1e-30
+                                                      : 1e-15),
+      2.0);
+  frame.samples = samples;
+  frame.offsets = offsets.data();
+  frame.subdivide = job.subdivide;
+  frame.adaptive = job.adaptive;
+  frame.cancelled = &cancelled;
+
+  // a cancelled job stops at the next tile and hands back nothing
+  std::vector<std::pair<TileKey, CachedTile>> tiles;
+  for (const Region &band : bands) {
+    const View view = viewOf(band);
+    frame.width = band.x1 - band.x0;
+    frame.height = band.y1 - band.y0;
+    frame.center = {view.centerX.toDouble(), view.centerY.toDouble()};
+    frame.centerLow = {view.centerX.lowDouble(), view.centerY.lowDouble()};
+    if (frame.fixedPoint) {
+      frame.fixedCenterX = view.centerX.twosComplement(fixedLimbs - 1);
+      frame.fixedCenterY = view.centerY.twosComplement(fixedLimbs - 1);
+    }
+    if (frame.perturb) {
+      frame.referenceOffset = orbit.offset(view);
+    }
+    frame.x0 = 0;
+    frame.y0 = 0;
+    frame.x1 = frame.width;
+    frame.y1 = frame.height;
+    renderer.render(frame);
+    renderer.refine(frame);
+    if (cancelled) {
+      return {};
+    }
+
+    const FrameBuffers buffers =
+        renderer.frameBuffers(frame.width, frame.height);
+    for (const Region &tile : jobTiles) {
+      if (tile.x0 >= band.x0 && tile.x1 <= band.x1 && tile.y0 >= band.y0 &&
+          tile.y1 <= band.y1) {
+        tiles.emplace_back(job.key(tile.x0 / size, tile.y0 / size),
+                           CachedTile::capture(buffers, tile.x0 - band.x0,
+                                               tile.y0 - band.y0,
+                                               job.maxIterations, samples));
+      }
+    }
+  }
+  return tiles;
+}
+
+} // namespace mandelbrot
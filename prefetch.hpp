@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cpu_renderer.hpp"
+#include "perturbation.hpp"
+#include "tile_cache.hpp"
+#include "view.hpp"
+
+namespace mandelbrot {
+
+// Tiles of one level of the pyramid, see TileKey, that aren't in the cache
+// yet.
+struct PrefetchJob {
+  // the grid the tiles are on, its scale and offsets don't matter
+  TileGrid grid;
+  int maxIterations = 0;
+  // main.cpp's formula but for the precision, which key adds
+  uint64_t formula = 0;
+  int samplesPerAxis = 1;
+  bool subdivide = false;
+  bool adaptive = false;
+  bool referencePrecision = false;
+  // whole tiles, row by row, in pixels of the level from the corner of
+  // tile (0, 0)
+  std::vector<Region> tiles;
+
+  // what the CPU renders the level in, see cpuPrecision
+  auto precision() const -> Precision;
+  // tile (i, j) of the grid
+  auto key(int i, int j) const -> TileKey;
+};
+
+// Renders tiles nobody asked for yet on a thread of its own, so that idle
+// time goes into the ones panning or zooming on is likely to need next.
+// It has its own CpuRenderer, whose threads only get cores nothing else
+// wants, and reference orbit. It only hands back finished tiles, the main
+// thread owns the cache they go into.
+struct Prefetcher {
+  // finished is called on the prefetch thread once a job is done.
+  explicit Prefetcher(std::function<void()> finished);
+  ~Prefetcher();
+  Prefetcher(const Prefetcher &) = delete;
+  auto operator=(const Prefetcher &) -> Prefetcher & = delete;
+
+  // a job is queued or running, or its tiles haven't been collected yet.
+  auto busy() -> bool;
+  // starts the job unless busy.
+  auto submit(PrefetchJob job) -> bool;
+  // the tiles of the last job, once it's done.
+  auto collect() -> std::vector<std::pair<TileKey, CachedTile>>;
+  // drops the queued job and stops the running one at its next tile, for
+  // when the view moved on. a stopped job hands back no tiles.
+  auto cancel() -> void;
+
+private:
+  std::function<void()> finished;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::optional<PrefetchJob> queued;
+  bool working = false;
+  bool stopping = false;
+  std::atomic<bool> cancelled = false;
+  std::vector<std::pair<TileKey, CachedTile>> done;
+
+  CpuRenderer renderer{true};
+  ReferenceOrbit orbit;
+  SeriesApproximation series;
+  BlaTable bla;
+  // last, everything it uses is there by the time it starts
+  std::thread thread;
+
+  auto work() -> void;
+  auto render(const PrefetchJob &job)
+      -> std::vector<std::pair<TileKey, CachedTile>>;
+};
+
+} // namespace mandelbrot
@@ -2,8 +2,24 @@
 
 in vec2 TexCoord;
 out vec4 FragColor;
+// see outputTexture in shader.comp
 uniform sampler2D outputTexture;
+// colours from 0 to maxIterations iterations, and where in it each
+// iteration count goes, see palette.hpp
+uniform sampler1D palette;
+uniform sampler1D transfer;
+uniform float maxIterations;
+
+// the first and last texel centres are at 0 and 1
+vec4 lookup(sampler1D table, float t)
+{
+  float size = float(textureSize(table, 0));
+  return texture(table, (t * (size - 1.0) + 0.5) / size);
+}
+
 void main()
 {
-  FragColor = texture(outputTexture, TexCoord);
-}
\ No newline at end of file
+  vec2 value = texture(outputTexture, TexCoord).rg;
+  float t = lookup(transfer, value.x / maxIterations).r;
+  FragColor = vec4(lookup(palette, t).rgb * value.y, 1.0);
+}
@@ -0,0 +1,890 @@
+#include "simd_kernel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace mandelbrot {
+
+namespace {
+
+// vector_size on a dependent alias template is dropped by gcc, so every
+// width spells its types out.
+template <int Width> struct Lanes;
+template <> struct Lanes<2> {
+  typedef double Double __attribute__((vector_size(16)));
+  typedef int64_t Mask __attribute__((vector_size(16)));
+  typedef uint64_t Limb __attribute__((vector_size(16)));
+};
+template <> struct Lanes<4> {
+  typedef double Double __attribute__((vector_size(32)));
+  typedef int64_t Mask __attribute__((vector_size(32)));
+  typedef uint64_t Limb __attribute__((vector_size(32)));
+};
+template <> struct Lanes<8> {
+  typedef double Double __attribute__((vector_size(64)));
+  typedef int64_t Mask __attribute__((vector_size(64)));
+  typedef uint64_t Limb __attribute__((vector_size(64)));
+};
+
+template <int Width> using DoubleVec = typename Lanes<Width>::Double;
+template <int Width> using MaskVec = typename Lanes<Width>::Mask;
+template <int Width> using LimbVec = typename Lanes<Width>::Limb;
+
+// lane access through memory without taking the vector's own address, that
+// would keep it out of registers for the whole loop.
+template <typename Vec, typename T>
+[[gnu::always_inline]] inline auto loadLanes(const T *lanes) -> Vec {
+  Vec v;
+  std::memcpy(&v, lanes, sizeof(v));
+  return v;
+}
+
+template <typename Vec, typename T>
+[[gnu::always_inline]] inline auto storeLanes(T *lanes, Vec v) -> void {
+  std::memcpy(lanes, &v, sizeof(v));
+}
+
+// A lane that escapes, runs out of iterations or falls into a cycle writes
+// its result and picks up the next pending point right away, instead of
+// idling until its whole vector is done. Lanes are only serviced every
+// refillInterval iterations, the horizontal work is too costly to do on
+// every one:
+// - blocks are cut short at the first lane's deadline instead of testing
+//   maxIterations per lane, an integer compare in the loop makes gcc
+//   scalarize it.
+// - the point cycles are detected against moves on after 16, 32, 64, ...
+//   iterations, Brent's schedule rounded to the service interval.
+// - z freezes once a lane escapes so its smooth count can be taken when
+//   it is serviced, with Distance its derivative too for the distance
+//   estimate.
+template <int Width, bool Distance>
+[[gnu::always_inline]] inline auto
+streamLanes(const double *cx, const double *cy, int *iterations, int *periods,
+            double *distances, double *smooth, size_t count,
+            int maxIterations, double periodTolerance) -> void {
+  constexpr int64_t refillInterval = 16;
+  if (maxIterations <= 0) {
+    std::fill_n(iterations, count, 0);
+    std::fill_n(periods, count, 0);
+    if constexpr (Distance) {
+      std::fill_n(distances, count, std::numeric_limits<double>::infinity());
+    }
+    if (smooth) {
+      std::fill_n(smooth, count, 0.0);
+    }
+    return;
+  }
+  DoubleVec<Width> x = {}, y = {}, cr = {}, ci = {}, sx = {}, sy = {};
+  DoubleVec<Width> dx = {}, dy = {};
+  MaskVec<Width> iteration = {}, active = {};
+  // point each lane is working on (count when idle), the step at which it
+  // reaches maxIterations and its cycle detection schedule.
+  size_t index[Width];
+  int64_t deadline[Width], savedAt[Width], saveWindow[Width];
+  std::fill_n(index, Width, count);
+  size_t next = 0;
+  int64_t step = 0;
+
+  while (true) {
+    // lanes are serviced through plain arrays, see loadLanes.
+    double xs[Width], ys[Width], crs[Width], cis[Width], sxs[Width], sys[Width];
+    double dxs[Width], dys[Width];
+    int64_t counts[Width], activeLanes[Width];
+    storeLanes(xs, x);
+    storeLanes(ys, y);
+    storeLanes(crs, cr);
+    storeLanes(cis, ci);
+    storeLanes(sxs, sx);
+    storeLanes(sys, sy);
+    storeLanes(dxs, dx);
+    storeLanes(dys, dy);
+    storeLanes(counts, iteration);
+    storeLanes(activeLanes, active);
+
+    bool busy = false;
+    int64_t block = refillInterval;
+    for (int lane = 0; lane < Width; lane++) {
+      if (index[lane] != count && activeLanes[lane] &&
+          step != deadline[lane]) {
+        if (counts[lane] - savedAt[lane] >= saveWindow[lane]) {
+          sxs[lane] = xs[lane];
+          sys[lane] = ys[lane];
+          savedAt[lane] = counts[lane];
+          saveWindow[lane] *= 2;
+        }
+      } else {
+        if (index[lane] != count) {
+          // stopped short of the limit without escaping: it cycled.
+          const bool cycled = !activeLanes[lane] &&
+                              xs[lane] * xs[lane] + ys[lane] * ys[lane] < 4.0;
+          iterations[index[lane]] = cycled ? maxIterations : int(counts[lane]);
+          periods[index[lane]] = cycled ? int(counts[lane] - savedAt[lane]) : 0;
+          const double norm = xs[lane] * xs[lane] + ys[lane] * ys[lane];
+          if constexpr (Distance) {
+            const double r = std::sqrt(norm);
+            distances[index[lane]] =
+                r >= 2.0 ? r * std::log(r) / std::hypot(dxs[lane], dys[lane])
+                         : std::numeric_limits<double>::infinity();
+          }
+          if (smooth) {
+            smooth[index[lane]] =
+                norm >= 4.0 ? smoothIterations(int(counts[lane]), xs[lane],
+                                               ys[lane], crs[lane], cis[lane])
+                            : maxIterations;
+          }
+          index[lane] = count;
+        }
+        activeLanes[lane] = 0;
+        if (next == count) {
+          continue;
+        }
+        xs[lane] = ys[lane] = sxs[lane] = sys[lane] = 0.0;
+        dxs[lane] = dys[lane] = 0.0;
+        crs[lane] = cx[next];
+        cis[lane] = cy[next];
+        counts[lane] = savedAt[lane] = 0;
+        saveWindow[lane] = refillInterval;
+        activeLanes[lane] = -1;
+        deadline[lane] = step + maxIterations;
+        index[lane] = next++;
+      }
+      block = std::min(block, deadline[lane] - step);
+      busy = true;
+    }
+    if (!busy) {
+      return;
+    }
+
+    x = loadLanes<DoubleVec<Width>>(xs);
+    y = loadLanes<DoubleVec<Width>>(ys);
+    cr = loadLanes<DoubleVec<Width>>(crs);
+    ci = loadLanes<DoubleVec<Width>>(cis);
+    sx = loadLanes<DoubleVec<Width>>(sxs);
+    sy = loadLanes<DoubleVec<Width>>(sys);
+    dx = loadLanes<DoubleVec<Width>>(dxs);
+    dy = loadLanes<DoubleVec<Width>>(dys);
+    iteration = loadLanes<MaskVec<Width>>(counts);
+    active = loadLanes<MaskVec<Width>>(activeLanes);
+
+    for (int64_t k = 0; k < block; k++) {
+      const DoubleVec<Width> xx = x * x;
+      const DoubleVec<Width> yy = y * y;
+      if constexpr (Distance) {
+        // z' = 2 z z' + 1
+        const DoubleVec<Width> ndx = 2.0 * (x * dx - y * dy) + 1.0;
+        const DoubleVec<Width> ndy = 2.0 * (x * dy + y * dx);
+        dx = active ? ndx : dx;
+        dy = active ? ndy : dy;
+      }
+      const DoubleVec<Width> ny = 2.0 * x * y + ci;
+      const DoubleVec<Width> nx = xx - yy + cr;
+      x = active ? nx : x;
+      y = active ? ny : y;
+      iteration -= active;
+      const DoubleVec<Width> ox = x - sx;
+      const DoubleVec<Width> oy = y - sy;
+      active &= x * x + y * y < 4.0;
+      active &= ox * ox + oy * oy >= periodTolerance;
+    }
+    step += block;
+  }
+}
+
+// Double-doubles: each number is the unevaluated sum high + low of two
+// doubles, about 106 bits of mantissa. The same algorithms as two_sum,
+// dd_add and dd_mul in shader.comp, a lane each.
+template <int Width> struct DoubleDoubleVec {
+  DoubleVec<Width> high, low;
+};
+
+template <int Width>
+[[gnu::always_inline]] inline auto twoSum(DoubleVec<Width> a,
+                                          DoubleVec<Width> b)
+    -> DoubleDoubleVec<Width> {
+  const DoubleVec<Width> s = a + b;
+  const DoubleVec<Width> v = s - a;
+  return {s, (a - (s - v)) + (b - v)};
+}
+
+// for |a| >= |b|
+template <int Width>
+[[gnu::always_inline]] inline auto quickTwoSum(DoubleVec<Width> a,
+                                               DoubleVec<Width> b)
+    -> DoubleDoubleVec<Width> {
+  const DoubleVec<Width> s = a + b;
+  return {s, b - (s - a)};
+}
+
+// a * b and its rounding error. Fused takes the error from an fma, compilers
+// turn the loop over the lanes into a single instruction. Hosts without one
+// split the factors into halves whose products are exact instead (Dekker).
+template <int Width, bool Fused>
+[[gnu::always_inline]] inline auto twoProduct(DoubleVec<Width> a,
+                                              DoubleVec<Width> b)
+    -> DoubleDoubleVec<Width> {
+  const DoubleVec<Width> p = a * b;
+  DoubleVec<Width> e;
+  if constexpr (Fused) {
+    for (int i = 0; i < Width; i++) {
+      e[i] = std::fma(a[i], b[i], -p[i]);
+    }
+  } else {
+    // 2^27 + 1
+    constexpr double split = 134217729.0;
+    const DoubleVec<Width> ta = split * a;
+    const DoubleVec<Width> tb = split * b;
+    const DoubleVec<Width> ah = ta - (ta - a);
+    const DoubleVec<Width> bh = tb - (tb - b);
+    const DoubleVec<Width> al = a - ah;
+    const DoubleVec<Width> bl = b - bh;
+    e = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+  }
+  return {p, e};
+}
+
+template <int Width>
+[[gnu::always_inline]] inline auto add(const DoubleDoubleVec<Width> &a,
+                                       const DoubleDoubleVec<Width> &b)
+    -> DoubleDoubleVec<Width> {
+  DoubleDoubleVec<Width> s = twoSum<Width>(a.high, b.high);
+  const DoubleDoubleVec<Width> t = twoSum<Width>(a.low, b.low);
+  s = quickTwoSum<Width>(s.high, s.low + t.high);
+  return quickTwoSum<Width>(s.high, s.low + t.low);
+}
+
+template <int Width, bool Fused>
+[[gnu::always_inline]] inline auto multiply(const DoubleDoubleVec<Width> &a,
+                                            const DoubleDoubleVec<Width> &b)
+    -> DoubleDoubleVec<Width> {
+  const DoubleDoubleVec<Width> p = twoProduct<Width, Fused>(a.high, b.high);
+  return quickTwoSum<Width>(p.high,
+                            p.low + (a.high * b.low + a.low * b.high));
+}
+
+template <int Width>
+[[gnu::always_inline]] inline auto negate(const DoubleDoubleVec<Width> &a)
+    -> DoubleDoubleVec<Width> {
+  return {-a.high, -a.low};
+}
+
+// streamLanes in double-doubles, z, c and the saved point of the cycle
+// detection each take a pair of vectors. Escaping and cycling are decided on
+// the high parts, the derivative stays in doubles: it only needs a few
+// digits and its magnitude, not its position on the plane.
+template <int Width, bool Fused, bool Distance>
+[[gnu::always_inline]] inline auto
+streamDoubleDoubleLanes(const double *cx, const double *cxLow,
+                        const double *cy, const double *cyLow,
+                        int *iterations, int *periods, double *distances,
+                        double *smooth, size_t count, int maxIterations,
+                        double periodTolerance) -> void {
+  constexpr int64_t refillInterval = 16;
+  if (maxIterations <= 0) {
+    std::fill_n(iterations, count, 0);
+    std::fill_n(periods, count, 0);
+    if constexpr (Distance) {
+      std::fill_n(distances, count, std::numeric_limits<double>::infinity());
+    }
+    if (smooth) {
+      std::fill_n(smooth, count, 0.0);
+    }
+    return;
+  }
+  DoubleDoubleVec<Width> x = {}, y = {}, cr = {}, ci = {}, sx = {}, sy = {};
+  DoubleVec<Width> dx = {}, dy = {};
+  MaskVec<Width> iteration = {}, active = {};
+  size_t index[Width];
+  int64_t deadline[Width], savedAt[Width], saveWindow[Width];
+  std::fill_n(index, Width, count);
+  size_t next = 0;
+  int64_t step = 0;
+
+  while (true) {
+    double xs[Width], xls[Width], ys[Width], yls[Width];
+    double crs[Width], crls[Width], cis[Width], cils[Width];
+    double sxs[Width], sxls[Width], sys[Width], syls[Width];
+    double dxs[Width], dys[Width];
+    int64_t counts[Width], activeLanes[Width];
+    storeLanes(xs, x.high);
+    storeLanes(xls, x.low);
+    storeLanes(ys, y.high);
+    storeLanes(yls, y.low);
+    storeLanes(crs, cr.high);
+    storeLanes(crls, cr.low);
+    storeLanes(cis, ci.high);
+    storeLanes(cils, ci.low);
+    storeLanes(sxs, sx.high);
+    storeLanes(sxls, sx.low);
+    storeLanes(sys, sy.high);
+    storeLanes(syls, sy.low);
+    storeLanes(dxs, dx);
+    storeLanes(dys, dy);
+    storeLanes(counts, iteration);
+    storeLanes(activeLanes, active);
+
+    bool busy = false;
+    int64_t block = refillInterval;
+    for (int lane = 0; lane < Width; lane++) {
+      if (index[lane] != count && activeLanes[lane] &&
+          step != deadline[lane]) {
+        if (counts[lane] - savedAt[lane] >= saveWindow[lane]) {
+          sxs[lane] = xs[lane];
+          sxls[lane] = xls[lane];
+          sys[lane] = ys[lane];
+          syls[lane] = yls[lane];
+          savedAt[lane] = counts[lane];
+          saveWindow[lane] *= 2;
+        }
+      } else {
+        if (index[lane] != count) {
+          const bool cycled = !activeLanes[lane] &&
+                              xs[lane] * xs[lane] + ys[lane] * ys[lane] < 4.0;
+          iterations[index[lane]] = cycled ? maxIterations : int(counts[lane]);
+          periods[index[lane]] = cycled ? int(counts[lane] - savedAt[lane]) : 0;
+          const double norm = xs[lane] * xs[lane] + ys[lane] * ys[lane];
+          if constexpr (Distance) {
+            const double r = std::sqrt(norm);
+            distances[index[lane]] =
+                r >= 2.0 ? r * std::log(r) / std::hypot(dxs[lane], dys[lane])
+                         : std::numeric_limits<double>::infinity();
+          }
+          if (smooth) {
+            smooth[index[lane]] =
+                norm >= 4.0 ? smoothIterations(int(counts[lane]), xs[lane],
+                                               ys[lane], crs[lane], cis[lane])
+                            : maxIterations;
+          }
+          index[lane] = count;
+        }
+        activeLanes[lane] = 0;
+        if (next == count) {
+          continue;
+        }
+        xs[lane] = xls[lane] = ys[lane] = yls[lane] = 0.0;
+        sxs[lane] = sxls[lane] = sys[lane] = syls[lane] = 0.0;
+        dxs[lane] = dys[lane] = 0.0;
+        crs[lane] = cx[next];
+        crls[lane] = cxLow[next];
+        cis[lane] = cy[next];
+        cils[lane] = cyLow[next];
+        counts[lane] = savedAt[lane] = 0;
+        saveWindow[lane] = refillInterval;
+        activeLanes[lane] = -1;
+        deadline[lane] = step + maxIterations;
+        index[lane] = next++;
+      }
+      block = std::min(block, deadline[lane] - step);
+      busy = true;
+    }
+    if (!busy) {
+      return;
+    }
+
+    x = {loadLanes<DoubleVec<Width>>(xs), loadLanes<DoubleVec<Width>>(xls)};
+    y = {loadLanes<DoubleVec<Width>>(ys), loadLanes<DoubleVec<Width>>(yls)};
+    cr = {loadLanes<DoubleVec<Width>>(crs), loadLanes<DoubleVec<Width>>(crls)};
+    ci = {loadLanes<DoubleVec<Width>>(cis), loadLanes<DoubleVec<Width>>(cils)};
+    sx = {loadLanes<DoubleVec<Width>>(sxs), loadLanes<DoubleVec<Width>>(sxls)};
+    sy = {loadLanes<DoubleVec<Width>>(sys), loadLanes<DoubleVec<Width>>(syls)};
+    dx = loadLanes<DoubleVec<Width>>(dxs);
+    dy = loadLanes<DoubleVec<Width>>(dys);
+    iteration = loadLanes<MaskVec<Width>>(counts);
+    active = loadLanes<MaskVec<Width>>(activeLanes);
+
+    for (int64_t k = 0; k < block; k++) {
+      const DoubleDoubleVec<Width> xx = multiply<Width, Fused>(x, x);
+      const DoubleDoubleVec<Width> yy = multiply<Width, Fused>(y, y);
+      const DoubleDoubleVec<Width> xy = multiply<Width, Fused>(x, y);
+      const DoubleDoubleVec<Width> nx =
+          add<Width>(add<Width>(xx, negate(yy)), cr);
+      const DoubleDoubleVec<Width> ny =
+          add<Width>({2.0 * xy.high, 2.0 * xy.low}, ci);
+      if constexpr (Distance) {
+        const DoubleVec<Width> ndx =
+            2.0 * (x.high * dx - y.high * dy) + 1.0;
+        const DoubleVec<Width> ndy = 2.0 * (x.high * dy + y.high * dx);
+        dx = active ? ndx : dx;
+        dy = active ? ndy : dy;
+      }
+      x = {active ? nx.high : x.high, active ? nx.low : x.low};
+      y = {active ? ny.high : y.high, active ? ny.low : y.low};
+      iteration -= active;
+      const DoubleVec<Width> ox = add<Width>(x, negate(sx)).high;
+      const DoubleVec<Width> oy = add<Width>(y, negate(sy)).high;
+      active &= x.high * x.high + y.high * y.high < 4.0;
+      active &= ox * ox + oy * oy >= periodTolerance;
+    }
+    step += block;
+  }
+}
+
+// Fixed point in the layout of Fixed in shader.comp: Limbs 32 bit limbs in
+// two's complement, least significant first, the last one the integer part.
+// Limb i of every lane shares a vector, each limb in the low half of its 64
+// bits so sums and products have room for their carries.
+template <int Width, int Limbs> struct FixedVec {
+  LimbVec<Width> limbs[Limbs];
+};
+
+constexpr uint64_t limbMask = 0xffff'ffffu;
+
+template <int Width, int Limbs>
+[[gnu::always_inline]] inline auto add(const FixedVec<Width, Limbs> &a,
+                                       const FixedVec<Width, Limbs> &b)
+    -> FixedVec<Width, Limbs> {
+  FixedVec<Width, Limbs> sum;
+  LimbVec<Width> carry = {};
+  for (int i = 0; i < Limbs; i++) {
+    const LimbVec<Width> limb = a.limbs[i] + b.limbs[i] + carry;
+    sum.limbs[i] = limb & limbMask;
+    carry = limb >> 32;
+  }
+  return sum;
+}
+
+// -a in the lanes of mask, a in the others.
+template <int Width, int Limbs>
+[[gnu::always_inline]] inline auto negate(const FixedVec<Width, Limbs> &a,
+                                          MaskVec<Width> mask)
+    -> FixedVec<Width, Limbs> {
+  const LimbVec<Width> flip = (LimbVec<Width>)mask & limbMask;
+  LimbVec<Width> carry = (LimbVec<Width>)mask & 1;
+  FixedVec<Width, Limbs> result;
+  for (int i = 0; i < Limbs; i++) {
+    const LimbVec<Width> limb = (a.limbs[i] ^ flip) + carry;
+    result.limbs[i] = limb & limbMask;
+    carry = limb >> 32;
+  }
+  return result;
+}
+
+template <int Width, int Limbs>
+[[gnu::always_inline]] inline auto
+negativeLanes(const FixedVec<Width, Limbs> &a) -> MaskVec<Width> {
+  return (a.limbs[Limbs - 1] >> 31) != 0;
+}
+
+// the product of the magnitudes truncated to the fraction limbs, skipping
+// the columns below the top two that fall off, like BigFixed's operator*.
+// Each column sums the low and the high halves of its limb products apart,
+// neither can carry out of 64 bits.
+template <int Width, int Limbs>
+[[gnu::always_inline]] inline auto
+multiplyMagnitudes(const FixedVec<Width, Limbs> &a,
+                   const FixedVec<Width, Limbs> &b) -> FixedVec<Width, Limbs> {
+  constexpr int fraction = Limbs - 1;
+  FixedVec<Width, Limbs> product;
+  LimbVec<Width> carry = {};
+  for (int column = std::max(fraction - 2, 0); column <= 2 * fraction;
+       column++) {
+    LimbVec<Width> low = carry;
+    LimbVec<Width> high = {};
+    const int last = std::min(column, fraction);
+    for (int i = std::max(column - fraction, 0); i <= last; i++) {
+      // the masks show the compiler the high halves are zero, clang makes
+      // this a single 32 x 32 bit multiply (pmuludq)
+      const LimbVec<Width> limbProduct =
+          (a.limbs[i] & limbMask) * (b.limbs[column - i] & limbMask);
+      low += limbProduct & limbMask;
+      high += limbProduct >> 32;
+    }
+    if (column >= fraction) {
+      product.limbs[column - fraction] = low & limbMask;
+    }
+    carry = (low >> 32) + high;
+  }
+  return product;
+}
+
+template <int Width, int Limbs>
+[[gnu::always_inline]] inline auto multiply(const FixedVec<Width, Limbs> &a,
+                                            const FixedVec<Width, Limbs> &b)
+    -> FixedVec<Width, Limbs> {
+  const MaskVec<Width> aNegative = negativeLanes(a);
+  const MaskVec<Width> bNegative = negativeLanes(b);
+  return negate(
+      multiplyMagnitudes(negate(a, aNegative), negate(b, bNegative)),
+      aNegative ^ bNegative);
+}
+
+// the same sum of limbs as fixed_to_double in shader.comp. A limb goes to a
+// double through the bits of 2^52 + limb, there is no vector conversion
+// from 64 bit integers below AVX-512.
+template <int Width, int Limbs>
+[[gnu::always_inline]] inline auto toDouble(const FixedVec<Width, Limbs> &a)
+    -> DoubleVec<Width> {
+  const MaskVec<Width> negative = negativeLanes(a);
+  const FixedVec<Width, Limbs> magnitude = negate(a, negative);
+  DoubleVec<Width> value = {};
+  double scale = 1.0;
+  for (int i = Limbs - 1; i >= 0; i--) {
+    const DoubleVec<Width> limb =
+        (DoubleVec<Width>)(magnitude.limbs[i] | 0x4330'0000'0000'0000u) -
+        0x1p52;
+    value += limb * scale;
+    scale *= 1.0 / 4294967296.0;
+  }
+  return negative ? -value : value;
+}
+
+// center + offset, the same as fixed_add(center, fixed_from_double(offset))
+// in shader.comp.
+template <int Limbs>
+auto fixedCoordinate(const uint32_t *center, double offset, uint32_t *limbs)
+    -> void {
+  double rest = std::abs(offset);
+  for (int i = Limbs - 1; i >= 0; i--) {
+    const double limb = std::floor(rest);
+    limbs[i] = uint32_t(limb);
+    rest = (rest - limb) * 4294967296.0;
+  }
+  uint64_t carry = offset < 0.0;
+  for (int i = 0; i < Limbs; i++) {
+    const uint64_t limb = uint64_t(offset < 0.0 ? ~limbs[i] : limbs[i]) + carry;
+    limbs[i] = uint32_t(limb);
+    carry = limb >> 32;
+  }
+  carry = 0;
+  for (int i = 0; i < Limbs; i++) {
+    const uint64_t limb = uint64_t(center[i]) + limbs[i] + carry;
+    limbs[i] = uint32_t(limb);
+    carry = limb >> 32;
+  }
+}
+
+// streamLanes in fixed point, with z, c and the saved point of the cycle
+// detection as FixedVecs. Escaping and cycling are decided on doubles of
+// them like in iterate_fixed, the derivative stays in doubles. The state
+// is too big for registers at any limb count, lanes are serviced in place
+// and always freeze once they're done. xx - yy is (x + y)(x - y), like the
+// shader, for one product less and the same rounding.
+template <int Width, int Limbs>
+[[gnu::always_inline]] inline auto
+streamFixedLanes(const uint32_t *centerX, const uint32_t *centerY,
+                 const double *offsetX, const double *offsetY,
+                 int *iterations, int *periods, double *distances,
+                 double *smooth, size_t count, int maxIterations,
+                 double periodTolerance) -> void {
+  constexpr int64_t refillInterval = 16;
+  if (maxIterations <= 0) {
+    std::fill_n(iterations, count, 0);
+    std::fill_n(periods, count, 0);
+    if (distances) {
+      std::fill_n(distances, count, std::numeric_limits<double>::infinity());
+    }
+    if (smooth) {
+      std::fill_n(smooth, count, 0.0);
+    }
+    return;
+  }
+  FixedVec<Width, Limbs> x = {}, y = {}, cr = {}, ci = {}, sx = {}, sy = {};
+  // z as doubles, as of the last escape test
+  DoubleVec<Width> zx = {}, zy = {}, dx = {}, dy = {};
+  MaskVec<Width> iteration = {}, active = {};
+  const MaskVec<Width> everyLane = MaskVec<Width>{} - 1;
+  size_t index[Width];
+  int64_t deadline[Width], savedAt[Width], saveWindow[Width];
+  std::fill_n(index, Width, count);
+  size_t next = 0;
+  int64_t step = 0;
+
+  while (true) {
+    bool busy = false;
+    int64_t block = refillInterval;
+    for (int lane = 0; lane < Width; lane++) {
+      if (index[lane] != count && active[lane] && step != deadline[lane]) {
+        if (iteration[lane] - savedAt[lane] >= saveWindow[lane]) {
+          for (int i = 0; i < Limbs; i++) {
+            sx.limbs[i][lane] = x.limbs[i][lane];
+            sy.limbs[i][lane] = y.limbs[i][lane];
+          }
+          savedAt[lane] = iteration[lane];
+          saveWindow[lane] *= 2;
+        }
+      } else {
+        if (index[lane] != count) {
+          const double r = zx[lane] * zx[lane] + zy[lane] * zy[lane];
+          const bool cycled = !active[lane] && r < 4.0;
+          const bool escaped = !active[lane] && !cycled;
+          iterations[index[lane]] =
+              cycled ? maxIterations : int(iteration[lane]);
+          periods[index[lane]] =
+              cycled ? int(iteration[lane] - savedAt[lane]) : 0;
+          if (distances) {
+            distances[index[lane]] =
+                escaped ? std::sqrt(r) * std::log(std::sqrt(r)) /
+                              std::hypot(dx[lane], dy[lane])
+                        : std::numeric_limits<double>::infinity();
+          }
+          if (smooth) {
+            smooth[index[lane]] =
+                escaped ? smoothIterations(int(iteration[lane]), zx[lane],
+                                           zy[lane], toDouble(cr)[lane],
+                                           toDouble(ci)[lane])
+                        : maxIterations;
+          }
+          index[lane] = count;
+        }
+        active[lane] = 0;
+        if (next == count) {
+          continue;
+        }
+        uint32_t limbs[Limbs];
+        fixedCoordinate<Limbs>(centerX, offsetX[next], limbs);
+        for (int i = 0; i < Limbs; i++) {
+          cr.limbs[i][lane] = limbs[i];
+        }
+        fixedCoordinate<Limbs>(centerY, offsetY[next], limbs);
+        for (int i = 0; i < Limbs; i++) {
+          ci.limbs[i][lane] = limbs[i];
+          x.limbs[i][lane] = y.limbs[i][lane] = 0;
+          sx.limbs[i][lane] = sy.limbs[i][lane] = 0;
+        }
+        zx[lane] = zy[lane] = dx[lane] = dy[lane] = 0.0;
+        iteration[lane] = savedAt[lane] = 0;
+        saveWindow[lane] = refillInterval;
+        active[lane] = -1;
+        deadline[lane] = step + maxIterations;
+        index[lane] = next++;
+      }
+      block = std::min(block, deadline[lane] - step);
+      busy = true;
+    }
+    if (!busy) {
+      return;
+    }
+
+    for (int64_t k = 0; k < block; k++) {
+      if (distances) {
+        const DoubleVec<Width> ndx = 2.0 * (zx * dx - zy * dy) + 1.0;
+        const DoubleVec<Width> ndy = 2.0 * (zx * dy + zy * dx);
+        dx = active ? ndx : dx;
+        dy = active ? ndy : dy;
+      }
+      const FixedVec<Width, Limbs> xy = multiply(x, y);
+      const FixedVec<Width, Limbs> nx =
+          add(multiply(add(x, y), add(x, negate(y, everyLane))), cr);
+      const FixedVec<Width, Limbs> ny = add(add(xy, xy), ci);
+      for (int i = 0; i < Limbs; i++) {
+        x.limbs[i] = active ? nx.limbs[i] : x.limbs[i];
+        y.limbs[i] = active ? ny.limbs[i] : y.limbs[i];
+      }
+      iteration -= active;
+
+      const DoubleVec<Width> ex = toDouble(x);
+      const DoubleVec<Width> ey = toDouble(y);
+      zx = active ? ex : zx;
+      zy = active ? ey : zy;
+      const DoubleVec<Width> ox = toDouble(add(x, negate(sx, everyLane)));
+      const DoubleVec<Width> oy = toDouble(add(y, negate(sy, everyLane)));
+      active &= zx * zx + zy * zy < 4.0;
+      active &= ox * ox + oy * oy >= periodTolerance;
+    }
+    step += block;
+  }
+}
+
+// the limb count as a template argument, so the loops over limbs unroll.
+template <int Width, int Limbs = 2>
+[[gnu::always_inline]] inline auto
+streamFixed(const uint32_t *centerX, const uint32_t *centerY, int limbs,
+            const double *offsetX, const double *offsetY, int *iterations,
+            int *periods, double *distances, double *smooth, size_t count,
+            int maxIterations, double periodTolerance) -> void {
+  if constexpr (Limbs <= maxFixedLimbs) {
+    if (limbs != Limbs) {
+      streamFixed<Width, Limbs + 1>(centerX, centerY, limbs, offsetX, offsetY,
+                                    iterations, periods, distances, smooth,
+                                    count, maxIterations, periodTolerance);
+      return;
+    }
+    streamFixedLanes<Width, Limbs>(centerX, centerY, offsetX, offsetY,
+                                   iterations, periods, distances, smooth,
+                                   count, maxIterations, periodTolerance);
+  }
+}
+
+// Function multiversioning: the loader resolves the dispatch to the best
+// version the host supports, the vector width follows the register size.
+// Callers outside this file would bind straight to the default version, so
+// the versions stay internal and the exported functions forward to them.
+__attribute__((target("default"))) auto
+dispatchStreaming(const double *cx, const double *cy, int *iterations,
+                  int *periods, double *distances, double *smooth,
+                  size_t count, int maxIterations, double periodTolerance)
+    -> void {
+  if (distances) {
+    streamLanes<2, true>(cx, cy, iterations, periods, distances, smooth,
+                          count, maxIterations, periodTolerance);
+  } else {
+    streamLanes<2, false>(cx, cy, iterations, periods, nullptr, smooth,
+                           count, maxIterations, periodTolerance);
+  }
+}
+
+__attribute__((target("avx2,fma"))) auto
+dispatchStreaming(const double *cx, const double *cy, int *iterations,
+                  int *periods, double *distances, double *smooth,
+                  size_t count, int maxIterations, double periodTolerance)
+    -> void {
+  if (distances) {
+    streamLanes<4, true>(cx, cy, iterations, periods, distances, smooth,
+                          count, maxIterations, periodTolerance);
+  } else {
+    streamLanes<4, false>(cx, cy, iterations, periods, nullptr, smooth,
+                           count, maxIterations, periodTolerance);
+  }
+}
+
+__attribute__((target("avx512f,avx512dq"))) auto
+dispatchStreaming(const double *cx, const double *cy, int *iterations,
+                  int *periods, double *distances, double *smooth,
+                  size_t count, int maxIterations, double periodTolerance)
+    -> void {
+  if (distances) {
+    streamLanes<8, true>(cx, cy, iterations, periods, distances, smooth,
+                          count, maxIterations, periodTolerance);
+  } else {
+    streamLanes<8, false>(cx, cy, iterations, periods, nullptr, smooth,
+                           count, maxIterations, periodTolerance);
+  }
+}
+
+// SSE2 has no fma, the default version splits its products.
+__attribute__((target("default"))) auto
+dispatchDoubleDouble(const double *cx, const double *cxLow, const double *cy,
+                     const double *cyLow, int *iterations, int *periods,
+                     double *distances, double *smooth, size_t count,
+                     int maxIterations, double periodTolerance) -> void {
+  if (distances) {
+    streamDoubleDoubleLanes<2, false, true>(cx, cxLow, cy, cyLow, iterations,
+                                            periods, distances, smooth, count,
+                                            maxIterations, periodTolerance);
+  } else {
+    streamDoubleDoubleLanes<2, false, false>(cx, cxLow, cy, cyLow, iterations,
+                                             periods, nullptr, smooth, count,
+                                             maxIterations, periodTolerance);
+  }
+}
+
+__attribute__((target("avx2,fma"))) auto
+dispatchDoubleDouble(const double *cx, const double *cxLow, const double *cy,
+                     const double *cyLow, int *iterations, int *periods,
+                     double *distances, double *smooth, size_t count,
+                     int maxIterations, double periodTolerance) -> void {
+  if (distances) {
+    streamDoubleDoubleLanes<4, true, true>(cx, cxLow, cy, cyLow, iterations,
+                                           periods, distances, smooth, count,
+                                           maxIterations, periodTolerance);
+  } else {
+    streamDoubleDoubleLanes<4, true, false>(cx, cxLow, cy, cyLow, iterations,
+                                            periods, nullptr, smooth, count,
+                                            maxIterations, periodTolerance);
+  }
+}
+
+__attribute__((target("avx512f,avx512dq"))) auto
+dispatchDoubleDouble(const double *cx, const double *cxLow, const double *cy,
+                     const double *cyLow, int *iterations, int *periods,
+                     double *distances, double *smooth, size_t count,
+                     int maxIterations, double periodTolerance) -> void {
+  if (distances) {
+    streamDoubleDoubleLanes<8, true, true>(cx, cxLow, cy, cyLow, iterations,
+                                           periods, distances, smooth, count,
+                                           maxIterations, periodTolerance);
+  } else {
+    streamDoubleDoubleLanes<8, true, false>(cx, cxLow, cy, cyLow, iterations,
+                                            periods, nullptr, smooth, count,
+                                            maxIterations, periodTolerance);
+  }
+}
+
+__attribute__((target("default"))) auto
+dispatchFixed(const uint32_t *centerX, const uint32_t *centerY, int limbs,
+              const double *offsetX, const double *offsetY, int *iterations,
+              int *periods, double *distances, double *smooth, size_t count,
+              int maxIterations, double periodTolerance) -> void {
+  streamFixed<2>(centerX, centerY, limbs, offsetX, offsetY, iterations,
+                 periods, distances, smooth, count, maxIterations,
+                 periodTolerance);
+}
+
+__attribute__((target("avx2,fma"))) auto
+dispatchFixed(const uint32_t *centerX, const uint32_t *centerY, int limbs,
+              const double *offsetX, const double *offsetY, int *iterations,
+              int *periods, double *distances, double *smooth, size_t count,
+              int maxIterations, double periodTolerance) -> void {
+  streamFixed<4>(centerX, centerY, limbs, offsetX, offsetY, iterations,
+                 periods, distances, smooth, count, maxIterations,
+                 periodTolerance);
+}
+
+__attribute__((target("avx512f,avx512dq"))) auto
+dispatchFixed(const uint32_t *centerX, const uint32_t *centerY, int limbs,
+              const double *offsetX, const double *offsetY, int *iterations,
+              int *periods, double *distances, double *smooth, size_t count,
+              int maxIterations, double periodTolerance) -> void {
+  streamFixed<8>(centerX, centerY, limbs, offsetX, offsetY, iterations,
+                 periods, distances, smooth, count, maxIterations,
+                 periodTolerance);
+}
+
+__attribute__((target("default"))) auto dispatchIsa() -> const char * {
+  return "sse2";
+}
+
+__attribute__((target("avx2,fma"))) auto dispatchIsa() -> const char * {
+  return "avx2";
+}
+
+__attribute__((target("avx512f,avx512dq"))) auto dispatchIsa() -> const char * {
+  return "avx512";
+}
+
+} // namespace
+
+auto escapeTimeStreaming(const double *cx, const double *cy, int *iterations,
+                         int *periods, double *distances, double *smooth,
+                         size_t count, int maxIterations,
+                         double periodTolerance) -> void {
+  dispatchStreaming(cx, cy, iterations, periods, distances, smooth, count,
+                    maxIterations, periodTolerance);
+}
+
+auto escapeTimeDoubleDouble(const double *cx, const double *cxLow,
+                            const double *cy, const double *cyLow,
+                            int *iterations, int *periods, double *distances,
+                            double *smooth, size_t count, int maxIterations,
+                            double periodTolerance) -> void {
+  dispatchDoubleDouble(cx, cxLow, cy, cyLow, iterations, periods, distances,
+                       smooth, count, maxIterations, periodTolerance);
+}
+
+auto escapeTimeFixed(const uint32_t *centerX, const uint32_t *centerY,
+                     int limbs, const double *offsetX, const double *offsetY,
+                     int *iterations, int *periods, double *distances,
+                     double *smooth, size_t count, int maxIterations,
+                     double periodTolerance) -> void {
+  // the kernels only come in 2 to maxFixedLimbs limbs, a centre in more
+  // loses its lowest ones and one in fewer gets zeros below
+  const int kernelLimbs = std::clamp(limbs, 2, maxFixedLimbs);
+  if (kernelLimbs != limbs) {
+    uint32_t x[maxFixedLimbs] = {}, y[maxFixedLimbs] = {};
+    const int dropped = std::max(0, limbs - kernelLimbs);
+    const int padded = std::max(0, kernelLimbs - limbs);
+    std::copy(centerX + dropped, centerX + limbs, x + padded);
+    std::copy(centerY + dropped, centerY + limbs, y + padded);
+    dispatchFixed(x, y, kernelLimbs, offsetX, offsetY, iterations, periods,
+                  distances, smooth, count, maxIterations, periodTolerance);
+    return;
+  }
+  dispatchFixed(centerX, centerY, limbs, offsetX, offsetY, iterations, periods,
+                distances, smooth, count, maxIterations, periodTolerance);
+}
+
+auto escapeTimeIsa() -> const char * { return dispatchIsa(); }
+
+} // namespace mandelbrot
@@ -0,0 +1,68 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace mandelbrot {
+
+// the continuous escape count n + 1 - log2(log|z|) of the orbit of c that
+// escaped to z after n iterations, taken a few iterations further out like
+// smooth_iterations in shader.comp.
+inline auto smoothIterations(int iterations, double x, double y, double cx,
+                             double cy) -> double {
+  for (int i = 0; i < 8 && x * x + y * y < 65536.0; i++) {
+    const double xy = x * y;
+    x = x * x - y * y + cx;
+    y = 2.0 * xy + cy;
+    iterations++;
+  }
+  return iterations + 1.0 - std::log2(0.5 * std::log(x * x + y * y));
+}
+
+// Escape time of count points c = (cx[i], cy[i]), iterated like iterate()
+// in shader.comp less its closed forms for the main bulbs. Vectorized 2, 4
+// or 8 points wide depending on what the host supports, picked once at load
+// time. Lanes that finish are refilled with the next point instead of
+// waiting for the rest of their vector, which keeps the vector unit busy
+// when iteration counts vary a lot, like near the boundary.
+// Points whose orbit returns to within sqrt(periodTolerance) of an earlier
+// point are interior, they bail out early with maxIterations and the cycle
+// length in periods (0 for everything else). Unless distances is null it
+// gets the exterior distance estimate |z| log|z| / |z'| of each point,
+// infinity for the ones that never escaped. Unless smooth is null it gets
+// their smoothIterations, maxIterations for the ones that never escaped.
+auto escapeTimeStreaming(const double *cx, const double *cy, int *iterations,
+                         int *periods, double *distances, double *smooth,
+                         size_t count, int maxIterations,
+                         double periodTolerance) -> void;
+
+// escapeTimeStreaming in double-double arithmetic, for c = (cx[i] +
+// cxLow[i], cy[i] + cyLow[i]): resolves pixels about 30 digits deep
+// without a reference orbit, at the same cost per iteration at any depth.
+// The same results as iterate_double_double in shader.comp.
+auto escapeTimeDoubleDouble(const double *cx, const double *cxLow,
+                            const double *cy, const double *cyLow,
+                            int *iterations, int *periods, double *distances,
+                            double *smooth, size_t count, int maxIterations,
+                            double periodTolerance) -> void;
+
+// most limbs escapeTimeFixed has a kernel for, about 1e-125 deep.
+static constexpr int maxFixedLimbs = 16;
+
+// escapeTimeStreaming in fixed point with limbs 32 bit limbs, for c =
+// center + (offsetX[i], offsetY[i]) with the centre given as
+// BigFixed::twosComplement limbs. Every point pays for the full precision
+// at any depth, no reference orbit and no glitches. Results are the same
+// as iterate_fixed in shader.comp, up to when cycles are caught. limbs goes
+// from 2 to maxFixedLimbs, a centre in more is rounded down to that many
+// and one in fewer padded with zeros.
+auto escapeTimeFixed(const uint32_t *centerX, const uint32_t *centerY,
+                     int limbs, const double *offsetX, const double *offsetY,
+                     int *iterations, int *periods, double *distances,
+                     double *smooth, size_t count, int maxIterations,
+                     double periodTolerance) -> void;
+
+// name of the instruction set the kernels dispatched to.
+auto escapeTimeIsa() -> const char *;
+
+} // namespace mandelbrot
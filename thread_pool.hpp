@@ -0,0 +1,162 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace mandelbrot {
+
+// Persistent workers with one deque each. Work is dealt round robin, a
+// worker pops from the front of its own deque and steals from the back of
+// the others once it runs dry, so uneven tiles balance themselves out.
+// Background pools' workers only take cores nothing else wants.
+struct ThreadPool {
+  explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency(),
+                      bool background = false) {
+    threads = std::max(1u, threads);
+    queues = std::vector<Queue>(threads);
+    for (unsigned i = 0; i < threads; i++) {
+      workers.emplace_back([this, i, background] {
+        if (background) {
+          yieldToOthers();
+        }
+        work(i);
+      });
+    }
+  }
+
+  // the calling thread only runs once no other thread wants its core, for
+  // the threads that help out a background pool.
+  static inline auto yieldToOthers() -> void {
+#ifdef SCHED_IDLE
+    const sched_param param{};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  auto operator=(const ThreadPool &) -> ThreadPool & = delete;
+
+  inline auto size() const -> size_t { return workers.size(); }
+
+  // runs task(index, worker) for every index in [0, count) and blocks until
+  // they have all finished. the calling thread helps out.
+  inline auto run(size_t count,
+                  const std::function<void(size_t, size_t)> &task) -> void {
+    if (count == 0) {
+      return;
+    }
+    {
+      std::lock_guard lock(mutex);
+      this->task = &task;
+      pending = count;
+      for (size_t i = 0; i < count; i++) {
+        Queue &queue = queues[i % queues.size()];
+        std::lock_guard queueLock(queue.mutex);
+        queue.items.push_back(i);
+      }
+      generation++;
+    }
+    wake.notify_all();
+
+    // the caller only steals, it shows up as worker size().
+    while (auto index = steal(0)) {
+      finish(*index, workers.size());
+    }
+    std::unique_lock lock(mutex);
+    done.wait(lock, [this] { return pending == 0; });
+    this->task = nullptr;
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<size_t> items;
+  };
+
+  std::vector<std::thread> workers;
+  std::vector<Queue> queues;
+  std::mutex mutex;
+  std::condition_variable wake, done;
+  const std::function<void(size_t, size_t)> *task = nullptr;
+  size_t pending = 0;
+  size_t generation = 0;
+  bool stopping = false;
+
+  inline auto pop(size_t worker) -> std::optional<size_t> {
+    Queue &queue = queues[worker];
+    std::lock_guard lock(queue.mutex);
+    if (queue.items.empty()) {
+      return std::nullopt;
+    }
+    const size_t index = queue.items.front();
+    queue.items.pop_front();
+    return index;
+  }
+
+  inline auto steal(size_t start) -> std::optional<size_t> {
+    for (size_t i = 0; i < queues.size(); i++) {
+      Queue &queue = queues[(start + i) % queues.size()];
+      std::lock_guard lock(queue.mutex);
+      if (!queue.items.empty()) {
+        const size_t index = queue.items.back();
+        queue.items.pop_back();
+        return index;
+      }
+    }
+    return std::nullopt;
+  }
+
+  inline auto finish(size_t index, size_t worker) -> void {
+    (*task)(index, worker);
+    std::lock_guard lock(mutex);
+    if (--pending == 0) {
+      done.notify_all();
+    }
+  }
+
+  inline auto work(size_t worker) -> void {
+    size_t seen = 0;
+    while (true) {
+      {
+        std::unique_lock lock(mutex);
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) {
+          return;
+        }
+        seen = generation;
+      }
+      while (true) {
+        auto index = pop(worker);
+        if (!index) {
+          index = steal(worker + 1);
+        }
+        if (!index) {
+          break;
+        }
+        finish(*index, worker);
+      }
+    }
+  }
+};
+
+} // namespace mandelbrot
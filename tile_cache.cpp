@@ -0,0 +1,320 @@
+#include "tile_cache.hpp"
+#include "cpu_renderer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+
+namespace mandelbrot {
+
+namespace {
+
+// the multiple of 2^exponent at or below value
+auto floorTo(BigFixed value, int64_t exponent) -> BigFixed {
+  const int64_t bit = exponent + int64_t(value.fractionLimbs()) * 32;
+  bool below = false;
+  for (size_t i = 0; i < value.limbs.size() && int64_t(i) * 32 < bit; i++) {
+    const int64_t bits = std::min<int64_t>(32, bit - int64_t(i) * 32);
+    const uint32_t mask = bits == 32 ? ~0u : (1u << bits) - 1;
+    below = below || (value.limbs[i] & mask);
+    value.limbs[i] &= ~mask;
+  }
+  // clearing the bits went towards 0, for negative values that's up
+  if (value.negative && below) {
+    value -= BigFixed::fromFloatExp(FloatExp(1.0).ldexp(exponent),
+                                    value.fractionLimbs());
+  }
+  return value;
+}
+
+// the tile pixels the frame pixel starting at low covers part of along an
+// axis, [first, last]
+auto span(double low, double scale) -> std::pair<int, int> {
+  return {int(std::floor(low)), int(std::ceil(low + scale)) - 1};
+}
+
+} // namespace
+
+auto TileKey::at(const View &view, int width, int height, int x, int y,
+                 int maxIterations, uint64_t formula) -> TileKey {
+  TileKey key;
+  key.spacing = view.pixelSpacing(height);
+  // the precision follows the spacing alone, so the same position comes
+  // out the same from every view at that level.
+  const size_t limbs = view.requiredLimbs(height);
+  key.x = view.centerX;
+  key.y = view.centerY;
+  key.x.setFractionLimbs(limbs);
+  key.y.setFractionLimbs(limbs);
+  // in fixed point, the spacing fits exactly and a whole (or half) number
+  // of it does too, where a FloatExp product would round.
+  const BigFixed spacing = BigFixed::fromFloatExp(key.spacing, limbs);
+  key.x += BigFixed(x - width / 2.0, limbs) * spacing;
+  key.y += BigFixed(y - height / 2.0, limbs) * spacing;
+  key.maxIterations = maxIterations;
+  key.formula = formula;
+  return key;
+}
+
+auto mergeRegions(const std::vector<Region> &regions) -> std::vector<Region> {
+  std::vector<Region> merged;
+  for (size_t begin = 0, end = 0; begin < regions.size(); begin = end) {
+    while (end < regions.size() && regions[end].y0 == regions[begin].y0) {
+      end++;
+    }
+    const size_t rowStart = merged.size();
+    for (size_t i = begin; i < end; i++) {
+      if (merged.size() > rowStart && merged.back().x1 == regions[i].x0 &&
+          merged.back().y1 == regions[i].y1) {
+        merged.back().x1 = regions[i].x1;
+      } else {
+        merged.push_back(regions[i]);
+      }
+    }
+    for (size_t i = rowStart; i < merged.size(); i++) {
+      const Region &strip = merged[i];
+      const auto above = std::find_if(
+          merged.begin(), merged.begin() + rowStart, [&](const Region &r) {
+            return r.x0 == strip.x0 && r.x1 == strip.x1 && r.y1 == strip.y0;
+          });
+      if (above != merged.begin() + rowStart) {
+        above->y1 = strip.y1;
+        merged.erase(merged.begin() + i--);
+      }
+    }
+  }
+  return merged;
+}
+
+auto CachedTile::capture(const FrameBuffers &frame, int x0, int y0,
+                         int maxIterations, int samples) -> CachedTile {
+  CachedTile tile;
+  tile.values.resize(size * size * 2);
+  tile.periods.resize(size * size);
+  tile.keys.resize(size * size);
+  for (int y = 0; y < size; y++) {
+    const size_t row = size_t(y0 + y) * frame.width + x0;
+    std::copy_n(&frame.values[row * 2], size * 2, &tile.values[y * size * 2]);
+    std::copy_n(&frame.periods[row], size, &tile.periods[y * size]);
+    std::copy_n(&frame.keys[row], size, &tile.keys[y * size]);
+  }
+
+  tile.uniform = true;
+  for (int p = 0; p < size * size; p++) {
+    const float *value = &tile.values[p * 2];
+    // escaped samples took their count, the rest all of maxIterations
+    tile.cost += samples * std::max(1.0, double(value[0]) * value[1] +
+                                             maxIterations * (1.0 - value[1]));
+    tile.uniform = tile.uniform && value[0] == tile.values[0] &&
+                   value[1] == tile.values[1] &&
+                   tile.periods[p] == tile.periods[0] &&
+                   tile.keys[p] == tile.keys[0];
+  }
+  if (tile.uniform) {
+    tile.values.resize(2);
+    tile.periods.resize(1);
+    tile.keys.resize(1);
+  }
+  return tile;
+}
+
+auto TileView::load(const FrameBuffers &frame, int x0, int y0,
+                    const Region &clip) const -> void {
+  constexpr int size = CachedTile::size;
+  const int left = std::max(clip.x0, x0) - x0;
+  const int right = std::min(clip.x1, x0 + size) - x0;
+  for (int y = std::max(clip.y0, y0) - y0;
+       y < std::min(clip.y1, y0 + size) - y0 && left < right; y++) {
+    const size_t row = size_t(y0 + y) * frame.width + x0;
+    if (uniform) {
+      for (int x = left; x < right; x++) {
+        std::copy_n(values, 2, &frame.values[(row + x) * 2]);
+      }
+      std::fill(&frame.periods[row + left], &frame.periods[row + right],
+                periods[0]);
+      std::fill(&frame.keys[row + left], &frame.keys[row + right], keys[0]);
+    } else {
+      const int p = y * size + left;
+      std::copy_n(&values[p * 2], (right - left) * 2,
+                  &frame.values[(row + left) * 2]);
+      std::copy_n(&periods[p], right - left, &frame.periods[row + left]);
+      std::copy_n(&keys[p], right - left, &frame.keys[row + left]);
+    }
+  }
+}
+
+auto TileGrid::of(const View &view, int width, int height) -> TileGrid {
+  TileGrid grid;
+  // the mantissa is in [0.5, 1), a frame pixel is 1 to 2 of the level's
+  const FloatExp spacing = view.pixelSpacing(height);
+  grid.level = spacing.exponent - 1;
+  grid.scale = spacing.mantissa * 2.0;
+  const size_t limbs = TileGrid::limbs(grid.level);
+  // the corner of the frame's first pixel, in fixed point the spacing and
+  // half the frame times it fit exactly
+  BigFixed cornerX = view.centerX;
+  BigFixed cornerY = view.centerY;
+  cornerX.setFractionLimbs(limbs);
+  cornerY.setFractionLimbs(limbs);
+  const BigFixed step = BigFixed::fromFloatExp(spacing, limbs);
+  cornerX -= BigFixed(width / 2.0, limbs) * step;
+  cornerY -= BigFixed(height / 2.0, limbs) * step;
+  const int64_t tile =
+      grid.level + std::countr_zero(unsigned(CachedTile::size));
+  grid.x = floorTo(cornerX, tile);
+  grid.y = floorTo(cornerY, tile);
+  grid.offsetX =
+      (cornerX - grid.x).toFloatExp().ldexp(-grid.level).toDouble();
+  grid.offsetY =
+      (cornerY - grid.y).toFloatExp().ldexp(-grid.level).toDouble();
+  return grid;
+}
+
+auto TileGrid::limbs(int64_t level) -> size_t {
+  return size_t(std::max(2.0, std::ceil(-double(level) / 32.0) + 2));
+}
+
+auto TileGrid::key(int i, int j, int maxIterations, uint64_t formula) const
+    -> TileKey {
+  // whole tiles of a power of two fit exactly, like the corner itself. the
+  // limbs are the ones at would take at that spacing.
+  const size_t limbs = TileGrid::limbs(level);
+  const int64_t tile = level + std::countr_zero(unsigned(CachedTile::size));
+  TileKey key{FloatExp(1.0).ldexp(level), x, y, maxIterations, formula};
+  key.x += BigFixed::fromFloatExp(FloatExp(double(i)).ldexp(tile), limbs);
+  key.y += BigFixed::fromFloatExp(FloatExp(double(j)).ldexp(tile), limbs);
+  return key;
+}
+
+auto TileGrid::tiles(const Region &region) const -> Region {
+  constexpr int size = CachedTile::size;
+  const auto first = [&](double offset, int p) {
+    return int(std::floor(span(offset + p * scale, scale).first /
+                          double(size)));
+  };
+  const auto last = [&](double offset, int p) {
+    return int(std::floor(span(offset + p * scale, scale).second /
+                          double(size)));
+  };
+  return {first(offsetX, region.x0), first(offsetY, region.y0),
+          last(offsetX, region.x1 - 1) + 1, last(offsetY, region.y1 - 1) + 1};
+}
+
+auto TileGrid::load(const FrameBuffers &frame, const Region &region,
+                    const std::vector<TileView> &tiles) const -> void {
+  constexpr int size = CachedTile::size;
+  const Region range = this->tiles(region);
+  const int columns = range.x1 - range.x0;
+  // tile pixel (u, v), counted from the first of tile (0, 0)
+  const auto pixel = [&](int u, int v) {
+    const TileView &tile =
+        tiles[size_t(v / size - range.y0) * columns + u / size - range.x0];
+    return std::pair(&tile, tile.uniform ? 0 : v % size * size + u % size);
+  };
+  for (int y = region.y0; y < region.y1; y++) {
+    const double lowY = offsetY + y * scale;
+    const auto [v0, v1] = span(lowY, scale);
+    for (int x = region.x0; x < region.x1; x++) {
+      const double lowX = offsetX + x * scale;
+      const auto [u0, u1] = span(lowX, scale);
+      const auto [middle, m] =
+          pixel(int(lowX + scale / 2.0), int(lowY + scale / 2.0));
+      const int key = middle->keys[m];
+      bool agree = true;
+      double sum = 0.0, escaped = 0.0;
+      for (int v = v0; v <= v1; v++) {
+        const double h =
+            std::min(lowY + scale, v + 1.0) - std::max(lowY, double(v));
+        for (int u = u0; u <= u1; u++) {
+          const double w =
+              h * (std::min(lowX + scale, u + 1.0) - std::max(lowX, double(u)));
+          const auto [tile, p] = pixel(u, v);
+          const float *in = &tile->values[p * 2];
+          sum += w * in[0] * in[1];
+          escaped += w * in[1];
+          agree = agree && tile->keys[p] == key;
+        }
+      }
+      const size_t target = size_t(y) * frame.width + x;
+      frame.values[target * 2] = escaped > 0.0 ? float(sum / escaped) : 0.0f;
+      frame.values[target * 2 + 1] = float(escaped / (scale * scale));
+      frame.periods[target] = middle->periods[m];
+      frame.keys[target] = agree ? key : CpuRenderer::edgeKey;
+    }
+  }
+}
+
+auto CachedTile::bytes() const -> size_t {
+  return sizeof(CachedTile) + values.size() * sizeof(values[0]) +
+         (periods.size() + keys.size()) * sizeof(int);
+}
+
+auto TileCache::Hash::operator()(const TileKey &key) const -> size_t {
+  size_t hash = std::hash<int64_t>{}(key.spacing.exponent);
+  const auto mix = [&](uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+  };
+  mix(std::bit_cast<uint64_t>(key.spacing.mantissa));
+  for (const BigFixed *coordinate : {&key.x, &key.y}) {
+    mix(coordinate->negative);
+    for (uint32_t limb : coordinate->limbs) {
+      mix(limb);
+    }
+  }
+  mix(uint64_t(key.maxIterations));
+  mix(key.formula);
+  return hash;
+}
+
+auto TileCache::find(const TileKey &key) -> const CachedTile * {
+  const auto found = entries.find(key);
+  if (found == entries.end()) {
+    return nullptr;
+  }
+  touch(found->first, found->second);
+  return &found->second.tile;
+}
+
+auto TileCache::insert(const TileKey &key, CachedTile tile) -> void {
+  const size_t bytes = tile.bytes();
+  if (bytes > budget) {
+    return;
+  }
+  auto [found, inserted] = entries.try_emplace(key);
+  if (!inserted) {
+    used -= found->second.tile.bytes();
+    order.erase(found->second.slot);
+  }
+  found->second.tile = std::move(tile);
+  used += bytes;
+  found->second.slot = order.end();
+  touch(found->first, found->second);
+
+  while (used > budget) {
+    // the lowest priority sets the floor the ones after it start from
+    const auto lowest = order.begin();
+    inflation = lowest->first;
+    const auto evicted = entries.find(*lowest->second);
+    used -= evicted->second.tile.bytes();
+    order.erase(lowest);
+    entries.erase(evicted);
+  }
+}
+
+auto TileCache::clear() -> void {
+  entries.clear();
+  order.clear();
+  used = 0;
+  inflation = 0.0;
+}
+
+auto TileCache::touch(const TileKey &key, Entry &entry) -> void {
+  if (entry.slot != order.end()) {
+    order.erase(entry.slot);
+  }
+  entry.slot = order.emplace(
+      inflation + entry.tile.cost / double(entry.tile.bytes()), &key);
+}
+
+} // namespace mandelbrot
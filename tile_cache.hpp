@@ -0,0 +1,151 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "view.hpp"
+
+namespace mandelbrot {
+
+// goes up whenever shader.comp or the CPU kernels change the pixels they
+// write. it's in the top half of every tile's formula, so the tiles a
+// TileStore kept from older builds don't pass for current ones.
+static constexpr uint64_t kernelVersion = 2;
+
+// Where a tile sits in the pyramid of every view: its pixels are spacing
+// apart and (x, y) is the corner of the first one. Finished frames keep
+// theirs (at), views whose pixels line up with them load them as they are.
+// The prefetcher renders tiles of levels instead, whose spacing is exactly
+// 2^level on a grid through 0, which every spacing within an octave above
+// resamples, see TileGrid. maxIterations and formula (a hash of whatever
+// else changes the pixels, like the samples) complete the key.
+struct TileKey {
+  FloatExp spacing;
+  BigFixed x, y;
+  int maxIterations = 0;
+  uint64_t formula = 0;
+
+  // the tile whose first pixel is (x, y) in a width x height frame of view.
+  static auto at(const View &view, int width, int height, int x, int y,
+                 int maxIterations, uint64_t formula) -> TileKey;
+
+  friend auto operator==(const TileKey &, const TileKey &) -> bool = default;
+};
+
+// Pixels [x0, x1) x [y0, y1) of a frame.
+struct Region {
+  int x0, y0, x1, y1;
+};
+
+// joins regions listed row by row into strips along the rows, and those
+// into rectangles across the rows where they line up. fewer, bigger regions
+// keep the renderers' workers busy.
+auto mergeRegions(const std::vector<Region> &regions) -> std::vector<Region>;
+
+// A whole frame worth of the buffers tiles are copied out of and into,
+// laid out like CpuRenderer's.
+struct FrameBuffers {
+  float *values;
+  int *periods;
+  int *keys;
+  int width;
+};
+
+// A tile's pixels wherever they're kept, in a CachedTile or straight in the
+// mapping of a TileStore. Uniform tiles have one pixel, the others size x
+// size rows.
+struct TileView {
+  bool uniform;
+  const float *values;
+  const int *periods;
+  const int *keys;
+
+  // copies the tile to (x0, y0) of the frame, only the part within clip.
+  auto load(const FrameBuffers &frame, int x0, int y0,
+            const Region &clip) const -> void;
+};
+
+// The tiles a frame takes its pixels from and where its pixels fall on
+// them. Counted in tile pixels from the corner of tile (0, 0), the one its
+// first pixel is in, frame pixel (x, y) covers [offsetX + x * scale,
+// offsetX + (x + 1) * scale) and the same along y.
+struct TileGrid {
+  int64_t level = 0;
+  // the corner of tile (0, 0)
+  BigFixed x, y;
+  // in [1, 2), frames never magnify tiles
+  double scale = 1.0;
+  double offsetX = 0.0;
+  double offsetY = 0.0;
+
+  static auto of(const View &view, int width, int height) -> TileGrid;
+  // what positions at level are kept in, the same for every view so their
+  // keys compare equal. View::requiredLimbs at a spacing of 2^level.
+  static auto limbs(int64_t level) -> size_t;
+
+  // tile (i, j) of the grid, counted from tile (0, 0).
+  auto key(int i, int j, int maxIterations, uint64_t formula) const
+      -> TileKey;
+  // the tiles [x0, x1) x [y0, y1) the pixels of region take samples from.
+  auto tiles(const Region &region) const -> Region;
+  // the pixels of region resampled from those tiles, listed row by row.
+  // they're weighted like the samples they averaged, the period and key
+  // are the ones in the middle but for keys that disagree, which refine
+  // takes for an edge.
+  auto load(const FrameBuffers &frame, const Region &region,
+            const std::vector<TileView> &tiles) const -> void;
+};
+
+struct CachedTile {
+  static constexpr int size = 32;
+
+  // every pixel the same, solid interior mostly. only one of them is kept.
+  bool uniform = false;
+  std::vector<float> values;
+  std::vector<int> periods;
+  std::vector<int> keys;
+  // iterations it took, what eviction goes by
+  double cost = 0.0;
+
+  static auto capture(const FrameBuffers &frame, int x0, int y0,
+                      int maxIterations, int samples) -> CachedTile;
+  inline auto view() const -> TileView {
+    return {uniform, values.data(), periods.data(), keys.data()};
+  }
+  auto bytes() const -> size_t;
+};
+
+// Cost aware LRU (GreedyDual-Size): a tile's priority is what recomputing
+// it costs per byte, on top of the priority of the last tile evicted at
+// the time it was last used. Cheap tiles go first, expensive ones outlive
+// a few rounds of them, and whatever isn't used ages out eventually.
+struct TileCache {
+  explicit TileCache(size_t budget = size_t(256) << 20) : budget(budget) {}
+
+  auto find(const TileKey &key) -> const CachedTile *;
+  auto insert(const TileKey &key, CachedTile tile) -> void;
+  inline auto size() const -> size_t { return entries.size(); }
+  auto clear() -> void;
+
+private:
+  struct Hash {
+    auto operator()(const TileKey &key) const -> size_t;
+  };
+  using Order = std::multimap<double, const TileKey *>;
+  struct Entry {
+    CachedTile tile;
+    Order::iterator slot;
+  };
+
+  size_t budget;
+  size_t used = 0;
+  double inflation = 0.0;
+  std::unordered_map<TileKey, Entry, Hash> entries;
+  Order order;
+
+  auto touch(const TileKey &key, Entry &entry) -> void;
+};
+
+} // namespace mandelbrot
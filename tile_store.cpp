@@ -0,0 +1,293 @@
+#include "tile_store.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mandelbrot {
+
+namespace {
+
+// changes whenever the layout of the file does
+constexpr uint64_t storeMagic = 0x0004'656c'6974'646dull;
+// the header gets a cache line to itself
+constexpr uint64_t headerBytes = 64;
+// slots looked at for a key before giving up on it, so a crowded index
+// costs a bounded scan rather than one over all of it.
+constexpr uint64_t maxProbes = 64;
+// a claim this old belongs to a process that died (or hung) between
+// claiming a slot and publishing its tile, anyone may take the slot over.
+constexpr uint64_t claimSeconds = 10;
+// set in a slot's offset while its tile is being written. the rest is
+// the low bits of the key's hash and the time the slot was claimed at, in
+// seconds. the hash has to be in the claim itself, the slot's own is only
+// stored after it.
+constexpr uint64_t claimedBit = uint64_t(1) << 63;
+constexpr uint64_t claimHashMask = 0x7fffffff;
+
+inline auto isClaim(uint64_t offset) -> bool {
+  return (offset & claimedBit) != 0;
+}
+
+inline auto claimNow(uint64_t hash) -> uint64_t {
+  return claimedBit | (hash & claimHashMask) << 32 |
+         uint32_t(std::time(nullptr));
+}
+
+// whether the claim is for a key with this hash, as far as it tells
+inline auto claimsHash(uint64_t offset, uint64_t hash) -> bool {
+  return (offset >> 32 & claimHashMask) == (hash & claimHashMask);
+}
+
+// a slot that's free, given up on, or claimed by someone long gone
+inline auto isClaimable(uint64_t offset) -> bool {
+  return offset == 0 ||
+         (isClaim(offset) &&
+          uint32_t(std::time(nullptr)) - uint32_t(offset) > claimSeconds);
+}
+
+// the key as bytes, what tiles in the log are told apart by. it's hashed
+// by hand below because std::hash doesn't promise the same value in every
+// process.
+auto serialize(const TileKey &key) -> std::vector<unsigned char> {
+  std::vector<unsigned char> bytes;
+  const auto append = [&](const void *data, size_t size) {
+    const auto *begin = static_cast<const unsigned char *>(data);
+    bytes.insert(bytes.end(), begin, begin + size);
+  };
+  append(&key.spacing.mantissa, sizeof(key.spacing.mantissa));
+  append(&key.spacing.exponent, sizeof(key.spacing.exponent));
+  append(&key.maxIterations, sizeof(key.maxIterations));
+  append(&key.formula, sizeof(key.formula));
+  for (const BigFixed *coordinate : {&key.x, &key.y}) {
+    const uint32_t header[2] = {uint32_t(coordinate->negative),
+                                uint32_t(coordinate->limbs.size())};
+    append(header, sizeof(header));
+    append(coordinate->limbs.data(),
+           coordinate->limbs.size() * sizeof(coordinate->limbs[0]));
+  }
+  return bytes;
+}
+
+// FNV-1a, never 0 which marks a free slot.
+auto hashBytes(const std::vector<unsigned char> &bytes) -> uint64_t {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (unsigned char byte : bytes) {
+    hash = (hash ^ byte) * 0x100000001b3ull;
+  }
+  return hash | 1;
+}
+
+inline auto align8(uint64_t bytes) -> uint64_t {
+  return (bytes + 7) & ~uint64_t(7);
+}
+
+// a tile in the log: this, the key, then the values, periods and keys of
+// its one (uniform) or size x size pixels, each padded to 8 bytes.
+struct Record {
+  uint32_t keyBytes;
+  uint32_t uniform;
+};
+
+inline auto pixelCount(bool uniform) -> uint64_t {
+  return uniform ? 1 : CachedTile::size * CachedTile::size;
+}
+
+} // namespace
+
+struct TileStore::Header {
+  uint64_t magic;
+  uint64_t slotCount;
+  uint64_t logBytes;
+  // where the next tile goes, from the start of the log. starts past 0,
+  // which marks free slots.
+  uint64_t logEnd;
+};
+
+// everything the slot is about is in offset: 0 is free, or given up on
+// when hash isn't 0 (the key's probe sequence goes on past it). a claim
+// (see claimedBit) is a tile still being written, anything else is where
+// the published tile is in the log. only free and given up on slots, and
+// stale claims, are ever claimed again, published tiles stay put.
+struct TileStore::Slot {
+  uint64_t hash;
+  uint64_t offset;
+};
+
+TileStore::TileStore(const char *path) {
+  const int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    std::cerr << "Could not open tile store " << path << std::endl;
+    return;
+  }
+  const size_t bytes = headerBytes + slotCount * sizeof(Slot) + logBytes;
+  // only setting the file up takes a lock, another process could be
+  // halfway through it.
+  flock(fd, LOCK_EX);
+  struct stat info {};
+  const bool fresh = fstat(fd, &info) == 0 && info.st_size == 0;
+  const bool sized = fresh ? ftruncate(fd, off_t(bytes)) == 0
+                           : size_t(info.st_size) == bytes;
+  void *mapping = sized ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, fd, 0)
+                        : MAP_FAILED;
+  if (mapping != MAP_FAILED) {
+    base = static_cast<unsigned char *>(mapping);
+    mappedBytes = bytes;
+    Header &h = header();
+    if (fresh) {
+      h = {storeMagic, slotCount, logBytes, 8};
+    } else if (h.magic != storeMagic || h.slotCount != slotCount ||
+               h.logBytes != logBytes) {
+      munmap(base, mappedBytes);
+      base = nullptr;
+    }
+  }
+  flock(fd, LOCK_UN);
+  // the mapping outlives the descriptor
+  close(fd);
+  if (!base) {
+    std::cerr << "Tile store " << path << " is unusable" << std::endl;
+  }
+}
+
+TileStore::~TileStore() {
+  if (base) {
+    munmap(base, mappedBytes);
+  }
+}
+
+auto TileStore::header() const -> Header & {
+  return *reinterpret_cast<Header *>(base);
+}
+
+auto TileStore::slots() const -> Slot * {
+  return reinterpret_cast<Slot *>(base + headerBytes);
+}
+
+auto TileStore::find(const TileKey &key) const -> std::optional<TileView> {
+  if (!base) {
+    return std::nullopt;
+  }
+  const std::vector<unsigned char> bytes = serialize(key);
+  const uint64_t hash = hashBytes(bytes);
+  const unsigned char *log = base + headerBytes + slotCount * sizeof(Slot);
+  for (uint64_t i = 0; i < maxProbes; i++) {
+    Slot &slot = slots()[(hash + i) % slotCount];
+    const uint64_t offset =
+        std::atomic_ref(slot.offset).load(std::memory_order_acquire);
+    const uint64_t slotHash =
+        std::atomic_ref(slot.hash).load(std::memory_order_acquire);
+    if (offset == 0 && slotHash == 0) {
+      // never used, nothing was put past it
+      return std::nullopt;
+    }
+    if (slotHash != hash || offset == 0 || isClaim(offset)) {
+      continue;
+    }
+    Record record;
+    std::memcpy(&record, log + offset, sizeof(record));
+    const unsigned char *data = log + offset + sizeof(record);
+    if (record.keyBytes != bytes.size() ||
+        std::memcmp(data, bytes.data(), bytes.size()) != 0) {
+      continue;
+    }
+    const uint64_t pixels = pixelCount(record.uniform);
+    data += align8(record.keyBytes);
+    const auto *values = reinterpret_cast<const float *>(data);
+    data += align8(pixels * 2 * sizeof(float));
+    const auto *periods = reinterpret_cast<const int *>(data);
+    data += align8(pixels * sizeof(int));
+    const auto *keys = reinterpret_cast<const int *>(data);
+    return TileView{bool(record.uniform), values, periods, keys};
+  }
+  return std::nullopt;
+}
+
+auto TileStore::insert(const TileKey &key, const CachedTile &tile) -> void {
+  if (!base) {
+    return;
+  }
+  const std::vector<unsigned char> bytes = serialize(key);
+  const uint64_t hash = hashBytes(bytes);
+  const uint64_t pixels = pixelCount(tile.uniform);
+  const uint64_t recordBytes = sizeof(Record) + align8(bytes.size()) +
+                               align8(pixels * 2 * sizeof(float)) +
+                               2 * align8(pixels * sizeof(int));
+  // a full log can't take it, no use claiming a slot that way
+  if (std::atomic_ref(header().logEnd).load(std::memory_order_relaxed) +
+          recordBytes >
+      logBytes) {
+    return;
+  }
+  unsigned char *log = base + headerBytes + slotCount * sizeof(Slot);
+  for (uint64_t i = 0; i < maxProbes; i++) {
+    Slot &slot = slots()[(hash + i) % slotCount];
+    std::atomic_ref slotOffset(slot.offset);
+    uint64_t offset = slotOffset.load(std::memory_order_acquire);
+    const uint64_t claim = claimNow(hash);
+    if (isClaimable(offset) &&
+        slotOffset.compare_exchange_strong(offset, claim,
+                                           std::memory_order_acq_rel)) {
+      // the slot is ours, the tile goes at the end of the log
+      std::atomic_ref(slot.hash).store(hash, std::memory_order_release);
+      const uint64_t end = std::atomic_ref(header().logEnd)
+                               .fetch_add(recordBytes,
+                                          std::memory_order_relaxed);
+      // another process took the last of it in the meantime. the slot
+      // is given up on, unless it was taken over already.
+      if (end + recordBytes > logBytes) {
+        uint64_t expected = claim;
+        slotOffset.compare_exchange_strong(expected, 0,
+                                           std::memory_order_release);
+        return;
+      }
+      unsigned char *data = log + end;
+      const Record record{uint32_t(bytes.size()), uint32_t(tile.uniform)};
+      std::memcpy(data, &record, sizeof(record));
+      data += sizeof(record);
+      std::memcpy(data, bytes.data(), bytes.size());
+      data += align8(bytes.size());
+      std::memcpy(data, tile.values.data(), pixels * 2 * sizeof(float));
+      data += align8(pixels * 2 * sizeof(float));
+      std::memcpy(data, tile.periods.data(), pixels * sizeof(int));
+      data += align8(pixels * sizeof(int));
+      std::memcpy(data, tile.keys.data(), pixels * sizeof(int));
+      // only published if nobody took the claim over for being stale
+      uint64_t expected = claim;
+      slotOffset.compare_exchange_strong(expected, end,
+                                         std::memory_order_release);
+      return;
+    }
+    // a tile with the same hash on its way is all but certainly this one.
+    // its slot may not have the hash yet, the claim does.
+    if (isClaim(offset)) {
+      if (claimsHash(offset, hash)) {
+        return;
+      }
+      continue;
+    }
+    const uint64_t slotHash =
+        std::atomic_ref(slot.hash).load(std::memory_order_acquire);
+    if (slotHash != hash || offset == 0) {
+      continue;
+    }
+    Record record;
+    std::memcpy(&record, log + offset, sizeof(record));
+    if (record.keyBytes == bytes.size() &&
+        std::memcmp(log + offset + sizeof(record), bytes.data(),
+                    bytes.size()) == 0) {
+      return;
+    }
+  }
+}
+
+} // namespace mandelbrot
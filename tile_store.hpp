@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "tile_cache.hpp"
+
+namespace mandelbrot {
+
+// TileCache's tiles on disk, memory mapped and shared by every process that
+// opens the same file. The file is a fixed size hash index followed by an
+// append only log of tiles. Neither takes a lock: appending claims an index
+// slot with a compare and swap, reserves space with an atomic add, writes
+// the tile, and only then publishes its offset in the slot, so readers never
+// see a tile half written. Claims that are never published, by a process
+// that died halfway, are taken over once they're stale. A key is looked for
+// in a bounded number of slots. Found tiles are read in place from the
+// mapping. Nothing is ever evicted, once the log is full new tiles are
+// dropped before they claim a slot.
+struct TileStore {
+  // slots of the index, and bytes of the log
+  static constexpr uint64_t slotCount = uint64_t(1) << 20;
+  static constexpr uint64_t logBytes = uint64_t(1) << 30;
+
+  // creates the file (sparse) if it doesn't exist yet. isOpen says if that
+  // worked.
+  explicit TileStore(const char *path);
+  ~TileStore();
+  TileStore(const TileStore &) = delete;
+  auto operator=(const TileStore &) -> TileStore & = delete;
+
+  inline auto isOpen() const -> bool { return base != nullptr; }
+
+  // the tile points into the mapping, valid as long as the store is.
+  auto find(const TileKey &key) const -> std::optional<TileView>;
+  // adds the tile unless some process has (or is adding) it already.
+  auto insert(const TileKey &key, const CachedTile &tile) -> void;
+
+private:
+  struct Header;
+  struct Slot;
+
+  unsigned char *base = nullptr;
+  size_t mappedBytes = 0;
+
+  auto header() const -> Header &;
+  auto slots() const -> Slot *;
+};
+
+} // namespace mandelbrot
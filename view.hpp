@@ -0,0 +1,78 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+#include "bigfixed.hpp"
+#include "floatexp.hpp"
+
+namespace mandelbrot {
+
+// The region of the complex plane being looked at. The centre is kept in
+// arbitrary precision and the scale in extended range so neither runs out
+// when zooming far past what a dvec2/dmat4 can address.
+struct View {
+  BigFixed centerX{0.0};
+  BigFixed centerY{0.0};
+  // half the height of the window in the complex plane, 1 / zoom.
+  FloatExp radius{1.0};
+
+  // deltas are iterated in doubles, keep the pixel spacing representable.
+  static constexpr double minimumRadiusLog2 = -960.0;
+
+  // size of one (square) pixel in the complex plane.
+  inline auto pixelSpacing(double height) const -> FloatExp {
+    return radius * FloatExp(2.0 / height);
+  }
+
+  inline auto zoomLog() const -> double { return -radius.log(); }
+
+  // iterations deep enough for the detail at this zoom.
+  inline auto maxIterations() const -> int {
+    return std::max(1, int(100 * (zoomLog() + 1)));
+  }
+
+  // the fraction limbs the centre needs to address individual pixels, with
+  // a couple of guard limbs for the reference orbit.
+  inline auto requiredLimbs(double height) const -> size_t {
+    const double bits = -pixelSpacing(height).log2();
+    return size_t(std::max(2.0, std::ceil(bits / 32.0) + 2));
+  }
+
+  inline auto updatePrecision(double height) -> void {
+    const size_t limbs = requiredLimbs(height);
+    centerX.setFractionLimbs(limbs);
+    centerY.setFractionLimbs(limbs);
+  }
+
+  // move the centre by an offset given in the complex plane.
+  inline auto pan(FloatExp dx, FloatExp dy) -> void {
+    const size_t limbs = centerX.fractionLimbs();
+    centerX += BigFixed::fromFloatExp(dx, limbs);
+    centerY += BigFixed::fromFloatExp(dy, limbs);
+  }
+
+  // move the centre by whole pixels. done in fixed point, where it's exact,
+  // so the pixels before and after the move line up.
+  inline auto panPixels(double dx, double dy, double height) -> void {
+    const size_t limbs = centerX.fractionLimbs();
+    const BigFixed spacing =
+        BigFixed::fromFloatExp(pixelSpacing(height), limbs);
+    centerX += BigFixed(dx, limbs) * spacing;
+    centerY += BigFixed(dy, limbs) * spacing;
+  }
+
+  inline auto zoomBy(double factor, double height) -> void {
+    radius /= FloatExp(factor);
+    if (radius.log2() < minimumRadiusLog2) {
+      radius = FloatExp(1.0).ldexp(int64_t(minimumRadiusLog2));
+    }
+    updatePrecision(height);
+  }
+
+  friend inline auto operator==(const View &a, const View &b) -> bool {
+    return a.radius == b.radius && a.centerX == b.centerX &&
+           a.centerY == b.centerY;
+  }
+};
+
+} // namespace mandelbrot